@@ -0,0 +1,83 @@
+/*
+ * Thread scaling of push_relabel<T, policy::parallel> on grid graphs, against
+ * the sequential max_label and fifo solvers. Build and run from the
+ * repository root:
+ *   g++ -std=c++17 -O2 bench/flow_parallel.cpp -o flow_parallel -pthread && ./flow_parallel [width height [max_threads]]
+ * With one thread the parallel policy runs the sequential fifo solver.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "../flow.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+typedef vector<tuple<size_t, size_t, long long>> edge_list;
+
+// Grid with random capacities in both directions, the source attached to
+// the left column and the sink to the right one
+static edge_list grid(size_t w, size_t h, size_t& n, size_t& s, size_t& t)
+{
+    mt19937 r(5);
+    n = w * h + 2;
+    s = w * h;
+    t = w * h + 1;
+    edge_list e;
+    for(size_t y = 0; y < h; y++)
+    {
+        for(size_t x = 0; x < w; x++)
+        {
+            size_t v = y * w + x;
+            if(x + 1 < w)
+            {
+                e.emplace_back(v, v + 1, (long long)(1 + r() % 100));
+                e.emplace_back(v + 1, v, (long long)(1 + r() % 100));
+            }
+            if(y + 1 < h)
+            {
+                e.emplace_back(v, v + w, (long long)(1 + r() % 100));
+                e.emplace_back(v + w, v, (long long)(1 + r() % 100));
+            }
+            if(x == 0)
+                e.emplace_back(s, v, (long long)(1 + r() % 1000));
+            if(x == w - 1)
+                e.emplace_back(v, t, (long long)(1 + r() % 1000));
+        }
+    }
+    return e;
+}
+
+template<typename P>
+static double timed(P& p, long long& value)
+{
+    auto start = chrono::steady_clock::now();
+    value = p.max_preflow();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv)
+{
+    size_t w = argc > 2 ? atoi(argv[1]) : 300;
+    size_t h = argc > 2 ? atoi(argv[2]) : 300;
+    size_t max_threads = argc > 3 ? atoi(argv[3]) : 32;
+    size_t n, s, t;
+    edge_list e = grid(w, h, n, s, t);
+    printf("grid %zux%zu, %zu edges, %u hardware threads\n", w, h, e.size(), thread::hardware_concurrency());
+    long long value;
+    push_relabel<long long, policy::max_label> max_label(n, e, s, t);
+    printf("  sequential max_label  %8.3f s\n", timed(max_label, value));
+    push_relabel<long long, policy::fifo> fifo(n, e, s, t);
+    printf("  sequential fifo       %8.3f s\n", timed(fifo, value));
+    for(size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+        push_relabel<long long, policy::parallel> parallel(n, e, s, t);
+        parallel.set_threads(threads);
+        long long check;
+        double time = timed(parallel, check);
+        printf("  parallel %2zu threads   %8.3f s%s\n", threads, time, check == value ? "" : "  WRONG VALUE");
+    }
+}
@@ -0,0 +1,127 @@
+/*
+ * Latency of push_relabel::set_capacity() followed by resolve(), against a
+ * fresh flow() call on the updated edges, for 10 and 1000 random capacity
+ * changes per round on a vision grid and on a random graph. Times are per
+ * round, averaged over five rounds. Build and run from the repository root:
+ *   g++ -std=c++17 -O2 bench/flow_resolve.cpp -o flow_resolve && ./flow_resolve [width height [random_vertices random_arcs]]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "../flow.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+typedef vector<tuple<size_t, size_t, long long>> edge_list;
+
+struct instance
+{
+    string name;
+    size_t n, s, t;
+    edge_list e;
+};
+
+// 4-connected grid with symmetric smoothness edges and source/sink links on
+// every pixel, as in image segmentation
+static instance vision(size_t w, size_t h)
+{
+    mt19937 r(1);
+    instance I{"vision " + to_string(w) + "x" + to_string(h), w * h + 2, w * h, w * h + 1, {}};
+    for(size_t y = 0; y < h; y++)
+    {
+        for(size_t x = 0; x < w; x++)
+        {
+            size_t v = y * w + x;
+            if(x + 1 < w)
+            {
+                long long c = 1 + r() % 50;
+                I.e.emplace_back(v, v + 1, c);
+                I.e.emplace_back(v + 1, v, c);
+            }
+            if(y + 1 < h)
+            {
+                long long c = 1 + r() % 50;
+                I.e.emplace_back(v, v + w, c);
+                I.e.emplace_back(v + w, v, c);
+            }
+            long long a = r() % 100, b = r() % 100;
+            if(a)
+                I.e.emplace_back(I.s, v, a);
+            if(b)
+                I.e.emplace_back(v, I.t, b);
+        }
+    }
+    return I;
+}
+
+static instance random_graph(size_t n, size_t m)
+{
+    mt19937 r(5);
+    instance I{"random n=" + to_string(n) + " m=" + to_string(m), n, 0, n - 1, {}};
+    for(size_t i = 0; i < m; i++)
+        I.e.emplace_back(r() % n, r() % n, (long long)(1 + r() % 100));
+    return I;
+}
+
+static double seconds_since(chrono::steady_clock::time_point start)
+{
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Every round changes `changes` random edges to a random capacity in
+// [0, 100), in the solver and in the edge list given to flow()
+template<typename U>
+static void run(const char* solver, instance I, size_t changes)
+{
+    const int rounds = 5;
+    mt19937 r(7);
+    push_relabel<long long, U> p(I.n, I.e, I.s, I.t);
+    auto start = chrono::steady_clock::now();
+    p.max_preflow();
+    double first = seconds_since(start);
+    double update = 0, resolve = 0, recompute = 0;
+    bool agree = true;
+    for(int round = 0; round < rounds; round++)
+    {
+        vector<pair<size_t, long long>> batch;
+        for(size_t j = 0; j < changes; j++)
+            batch.emplace_back(r() % I.e.size(), (long long)(r() % 100));
+        start = chrono::steady_clock::now();
+        for(const auto& c: batch)
+            p.set_capacity(c.first, c.second);
+        update += seconds_since(start);
+        start = chrono::steady_clock::now();
+        long long value = p.resolve();
+        resolve += seconds_since(start);
+        for(const auto& c: batch)
+            get<2>(I.e[c.first]) = c.second;
+        start = chrono::steady_clock::now();
+        agree = agree && value == flow<long long, U>(I.n, I.e, I.s, I.t);
+        recompute += seconds_since(start);
+    }
+    printf("  %-10s %4zu changes   first %.3f s   update %.4f s   resolve %.3f s   recompute %.3f s%s\n", solver,
+           changes, first, update / rounds, resolve / rounds, recompute / rounds, agree ? "" : "  WRONG VALUE");
+    fflush(stdout);
+}
+
+int main(int argc, char** argv)
+{
+    size_t w = argc > 2 ? atoi(argv[1]) : 1024;
+    size_t h = argc > 2 ? atoi(argv[2]) : 1024;
+    size_t n = argc > 4 ? atoi(argv[3]) : 100000;
+    size_t m = argc > 4 ? atoi(argv[4]) : 1000000;
+    for(const instance& I: {vision(w, h), random_graph(n, m)})
+    {
+        printf("%s, %zu edges\n", I.name.c_str(), I.e.size());
+        for(size_t changes: {10, 1000})
+        {
+            run<policy::max_label>("max_label", I, changes);
+            run<policy::fifo>("fifo", I, changes);
+        }
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ * Compares the flow() solvers (push-relabel with max_label and fifo, Dinic
+ * and Boykov-Kolmogorov) on the same generated instances: vision-like grids,
+ * grids with the terminals on opposite sides, random graphs and deep layered
+ * graphs. Build and run from the repository root:
+ *   g++ -std=c++17 -O2 bench/flow_solvers.cpp -o flow_solvers && ./flow_solvers [all | instance...]
+ * Instance names are the ones printed in brackets. Boykov-Kolmogorov on
+ * layered100 takes more than ten minutes, so it only runs when the instances
+ * are named on the command line or "all" is given.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "../flow.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+typedef vector<tuple<size_t, size_t, long long>> edge_list;
+
+struct instance
+{
+    string name, description;
+    size_t n, s, t;
+    edge_list e;
+};
+
+// 4-connected grid with symmetric smoothness edges and source/sink links on
+// every pixel, as in image segmentation
+static instance vision(const string& name, size_t w, size_t h)
+{
+    mt19937 r(1);
+    instance I{name, "vision " + to_string(w) + "x" + to_string(h), w * h + 2, w * h, w * h + 1, {}};
+    for(size_t y = 0; y < h; y++)
+    {
+        for(size_t x = 0; x < w; x++)
+        {
+            size_t v = y * w + x;
+            if(x + 1 < w)
+            {
+                long long c = 1 + r() % 50;
+                I.e.emplace_back(v, v + 1, c);
+                I.e.emplace_back(v + 1, v, c);
+            }
+            if(y + 1 < h)
+            {
+                long long c = 1 + r() % 50;
+                I.e.emplace_back(v, v + w, c);
+                I.e.emplace_back(v + w, v, c);
+            }
+            long long a = r() % 100, b = r() % 100;
+            if(a)
+                I.e.emplace_back(I.s, v, a);
+            if(b)
+                I.e.emplace_back(v, I.t, b);
+        }
+    }
+    return I;
+}
+
+// Grid with random capacities in both directions, the source attached to
+// the left column and the sink to the right one
+static instance grid(const string& name, size_t w, size_t h)
+{
+    mt19937 r(5);
+    instance I{name, "grid " + to_string(w) + "x" + to_string(h), w * h + 2, w * h, w * h + 1, {}};
+    for(size_t y = 0; y < h; y++)
+    {
+        for(size_t x = 0; x < w; x++)
+        {
+            size_t v = y * w + x;
+            if(x + 1 < w)
+            {
+                I.e.emplace_back(v, v + 1, (long long)(1 + r() % 100));
+                I.e.emplace_back(v + 1, v, (long long)(1 + r() % 100));
+            }
+            if(y + 1 < h)
+            {
+                I.e.emplace_back(v, v + w, (long long)(1 + r() % 100));
+                I.e.emplace_back(v + w, v, (long long)(1 + r() % 100));
+            }
+            if(x == 0)
+                I.e.emplace_back(I.s, v, (long long)(1 + r() % 1000));
+            if(x == w - 1)
+                I.e.emplace_back(v, I.t, (long long)(1 + r() % 1000));
+        }
+    }
+    return I;
+}
+
+static instance random_graph(const string& name, size_t n, size_t m)
+{
+    mt19937 r(5);
+    instance I{name, "random n=" + to_string(n) + " m=" + to_string(m), n, 0, n - 1, {}};
+    for(size_t i = 0; i < m; i++)
+        I.e.emplace_back(r() % n, r() % n, (long long)(1 + r() % 100));
+    return I;
+}
+
+// `layers` layers of `width` vertices, each vertex with `degree` arcs to
+// random vertices of the next layer
+static instance layered(const string& name, size_t layers, size_t width, size_t degree)
+{
+    mt19937 r(9);
+    instance I{name, "layered " + to_string(layers) + "x" + to_string(width) + " deg " + to_string(degree),
+               layers * width + 2, layers * width, layers * width + 1, {}};
+    for(size_t i = 0; i < width; i++)
+    {
+        I.e.emplace_back(I.s, i, (long long)(1 + r() % 1000));
+        I.e.emplace_back((layers - 1) * width + i, I.t, (long long)(1 + r() % 1000));
+    }
+    for(size_t l = 0; l + 1 < layers; l++)
+        for(size_t i = 0; i < width; i++)
+            for(size_t k = 0; k < degree; k++)
+                I.e.emplace_back(l * width + i, (l + 1) * width + r() % width, (long long)(1 + r() % 100));
+    return I;
+}
+
+template<typename U>
+static void run(const char* solver, const instance& I, long long& reference)
+{
+    auto start = chrono::steady_clock::now();
+    long long value = flow<long long, U>(I.n, I.e, I.s, I.t);
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if(reference < 0)
+        reference = value;
+    printf("  %-18s %8.3f s%s\n", solver, time, value == reference ? "" : "  WRONG VALUE");
+    fflush(stdout);
+}
+
+static bool selected(int argc, char** argv, const string& name)
+{
+    if(argc < 2 || !strcmp(argv[1], "all"))
+        return true;
+    for(int i = 1; i < argc; i++)
+        if(name == argv[i])
+            return true;
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    const struct
+    {
+        const char* name;
+        instance (*make)(const char*);
+    } instances[] = {
+        {"vision512", [](const char* name) { return vision(name, 512, 512); }},
+        {"vision1024", [](const char* name) { return vision(name, 1024, 1024); }},
+        {"grid300", [](const char* name) { return grid(name, 300, 300); }},
+        {"random100k", [](const char* name) { return random_graph(name, 100000, 1000000); }},
+        {"random5k", [](const char* name) { return random_graph(name, 5000, 1000000); }},
+        {"layered20", [](const char* name) { return layered(name, 20, 500, 8); }},
+        {"layered40", [](const char* name) { return layered(name, 40, 500, 8); }},
+        {"layered100", [](const char* name) { return layered(name, 100, 2000, 8); }},
+    };
+    for(const auto& entry : instances)
+    {
+        if(!selected(argc, argv, entry.name))
+            continue;
+        instance I = entry.make(entry.name);
+        printf("%s [%s], m=%zu\n", I.description.c_str(), I.name.c_str(), I.e.size());
+        long long reference = -1;
+        run<policy::max_label>("max_label", I, reference);
+        run<policy::fifo>("fifo", I, reference);
+        run<policy::dinic>("dinic", I, reference);
+        if(I.name != "layered100" || argc > 1)
+            run<policy::boykov_kolmogorov>("boykov_kolmogorov", I, reference);
+        else
+            printf("  %-18s skipped, pass \"all\" or \"layered100\"\n", "boykov_kolmogorov");
+    }
+}
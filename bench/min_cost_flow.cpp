@@ -0,0 +1,108 @@
+/*
+ * Compares the min_cost_flow() solvers, policy::cost_scaling against
+ * successive shortest paths with policy::pairing, on transportation
+ * instances: suppliers linked to every consumer (complete) or to a few
+ * random ones (sparse), costs 1..1000. Build and run from the repository
+ * root:
+ *   g++ -std=c++17 -O2 bench/min_cost_flow.cpp -o min_cost_flow && ./min_cost_flow [all | instance...]
+ * Instance names are the ones printed in brackets. Successive shortest paths
+ * takes minutes on sparse20000 and longer on sparse100000, so there it only
+ * runs when the instances are named on the command line or "all" is given.
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "../flow.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+typedef vector<tuple<size_t, size_t, long long, long long>> edge_list;
+
+struct instance
+{
+    string name, description;
+    size_t n, s, t;
+    edge_list e;
+};
+
+// `suppliers` vertices fed by the source and `consumers` vertices draining
+// into the sink; each supplier gets `degree` arcs to random consumers, or to
+// all of them when `degree` equals `consumers`
+static instance transport(const string& name, size_t suppliers, size_t consumers, size_t degree, unsigned seed)
+{
+    mt19937 r(seed);
+    instance I{name, (degree == consumers ? "complete " : "sparse ") + to_string(suppliers) + "x" + to_string(consumers) + (degree == consumers ? "" : " deg " + to_string(degree)),
+               suppliers + consumers + 2, suppliers + consumers, suppliers + consumers + 1, {}};
+    for(size_t i = 0; i < suppliers; i++)
+        I.e.emplace_back(I.s, i, (long long)(100 + r() % 900), 0LL);
+    for(size_t j = 0; j < consumers; j++)
+        I.e.emplace_back(suppliers + j, I.t, (long long)(100 + r() % 900), 0LL);
+    for(size_t i = 0; i < suppliers; i++)
+    {
+        for(size_t k = 0; k < degree; k++)
+        {
+            size_t j = degree == consumers ? k : r() % consumers;
+            I.e.emplace_back(i, suppliers + j, (long long)(50 + r() % 500), (long long)(1 + r() % 1000));
+        }
+    }
+    return I;
+}
+
+template<typename U>
+static void run(const char* solver, const instance& I, min_cost_flow_result<long long, long long>& reference, bool& first)
+{
+    auto start = chrono::steady_clock::now();
+    min_cost_flow_result<long long, long long> r = min_cost_flow<long long, long long, U>(I.n, I.e, I.s, I.t);
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if(first)
+        reference = r;
+    first = false;
+    printf("  %-14s flow %9lld   cost %13lld %9.3f s%s\n", solver, r.value, r.cost, time,
+           r.value == reference.value && r.cost == reference.cost ? "" : "  WRONG RESULT");
+    fflush(stdout);
+}
+
+static bool selected(int argc, char** argv, const string& name)
+{
+    if(argc < 2 || !strcmp(argv[1], "all"))
+        return true;
+    for(int i = 1; i < argc; i++)
+        if(name == argv[i])
+            return true;
+    return false;
+}
+
+int main(int argc, char** argv)
+{
+    const struct
+    {
+        const char* name;
+        bool slow_ssp;
+        instance (*make)(const char*);
+    } instances[] = {
+        {"complete400", false, [](const char* name) { return transport(name, 400, 400, 400, 1); }},
+        {"complete1000", false, [](const char* name) { return transport(name, 1000, 1000, 1000, 2); }},
+        {"sparse2000", false, [](const char* name) { return transport(name, 2000, 2000, 30, 4); }},
+        {"sparse20000", true, [](const char* name) { return transport(name, 20000, 20000, 10, 3); }},
+        {"sparse100000", true, [](const char* name) { return transport(name, 100000, 100000, 5, 5); }},
+    };
+    for(const auto& entry: instances)
+    {
+        if(!selected(argc, argv, entry.name))
+            continue;
+        instance I = entry.make(entry.name);
+        printf("%s [%s], m=%zu\n", I.description.c_str(), I.name.c_str(), I.e.size());
+        min_cost_flow_result<long long, long long> reference;
+        bool first = true;
+        run<policy::cost_scaling>("cost_scaling", I, reference, first);
+        if(!entry.slow_ssp || argc > 1)
+            run<policy::pairing>("pairing", I, reference, first);
+        else
+            printf("  %-14s skipped, pass \"all\" or \"%s\"\n", "pairing", entry.name);
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Pop throughput of the pointer pairing_heap with policy::two_pass and
+ * policy::multipass: N keys are inserted, in random or in increasing order,
+ * then popped until the heap is empty. Increasing insertions leave the root
+ * with N - 1 children, the case that overflowed the stack of the old
+ * recursive merge_pairs. Each run reuses the nodes freed by the previous one,
+ * so sorted keys do not get nodes laid out in insertion order; with fresh
+ * memory the sorted case is several times faster for both policies. Build
+ * and run from the repository root:
+ *   g++ -std=c++17 -O2 bench/pairing_heap.cpp -o pairing_heap && ./pairing_heap [N...]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../pairing_heap.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+// Millions of pops per second, timing only the pops
+template<typename Heap>
+static double run(const vector<unsigned>& keys, unsigned long& checksum)
+{
+    Heap* root = nullptr;
+    for(unsigned x : keys)
+        root = Heap::insert(root, x);
+    auto start = chrono::steady_clock::now();
+    while(root)
+    {
+        checksum = checksum * 31 + Heap::top(root);
+        root = Heap::remove_top(root);
+    }
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return keys.size() / time / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    vector<size_t> sizes;
+    for(int i = 1; i < argc; i++)
+        sizes.push_back(atoi(argv[i]));
+    if(sizes.empty())
+        sizes = {100000, 4000000};
+    for(size_t n : sizes)
+    {
+        mt19937 r(1);
+        vector<unsigned> random_keys(n);
+        for(unsigned& x : random_keys)
+            x = r();
+        vector<unsigned> sorted_keys = random_keys;
+        sort(sorted_keys.begin(), sorted_keys.end());
+        printf("N = %zu           random      sorted  (Mpop/s)\n", n);
+        unsigned long two_pass_sum = 0, multipass_sum = 0;
+        typedef pairing_heap<unsigned, less<unsigned>, policy::two_pass> two_pass_heap;
+        typedef pairing_heap<unsigned, less<unsigned>, policy::multipass> multipass_heap;
+        double a = run<two_pass_heap>(random_keys, two_pass_sum);
+        double b = run<two_pass_heap>(sorted_keys, two_pass_sum);
+        printf("  two_pass      %10.2f  %10.2f\n", a, b);
+        a = run<multipass_heap>(random_keys, multipass_sum);
+        b = run<multipass_heap>(sorted_keys, multipass_sum);
+        printf("  multipass     %10.2f  %10.2f%s\n", a, b, two_pass_sum == multipass_sum ? "" : "  WRONG ORDER");
+    }
+}
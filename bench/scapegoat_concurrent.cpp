@@ -0,0 +1,109 @@
+/*
+ * Read throughput of concurrent_scapegoat against a mutex-wrapped scapegoat,
+ * with 1 to max_threads reader threads doing random find() and one writer
+ * doing an insert or erase every 100 microseconds. Build and run from the
+ * repository root:
+ *   g++ -std=c++17 -O2 bench/scapegoat_concurrent.cpp -o scapegoat_concurrent -pthread && ./scapegoat_concurrent [keys [max_threads]]
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../scapegoat.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+// Keeps the finds from being optimized away
+static atomic<long> hits(0);
+
+// Millions of reads per second over 1.5 s
+template<typename Find, typename Write>
+static double run(unsigned threads, int keys, Find find, Write write)
+{
+    atomic<bool> stop(false);
+    atomic<long> reads(0);
+    vector<thread> readers;
+    for(unsigned t = 0; t < threads; t++)
+    {
+        readers.emplace_back([&, t]()
+        {
+            mt19937 r(t);
+            long count = 0, found = 0;
+            while(!stop.load(memory_order_relaxed))
+            {
+                for(int k = 0; k < 256; k++)
+                    found += find(int(r() % (2 * keys)));
+                count += 256;
+            }
+            reads += count;
+            hits += found;
+        });
+    }
+    thread writer([&]()
+    {
+        mt19937 r(7);
+        while(!stop.load())
+        {
+            write(int(r() % (2 * keys)));
+            this_thread::sleep_for(chrono::microseconds(100));
+        }
+    });
+    this_thread::sleep_for(chrono::milliseconds(1500));
+    stop.store(true);
+    for(auto& i: readers)
+        i.join();
+    writer.join();
+    return reads.load() / 1.5 / 1e6;
+}
+
+int main(int argc, char** argv)
+{
+    int keys = argc > 1 ? atoi(argv[1]) : 1000000;
+    unsigned max_threads = argc > 2 ? atoi(argv[2]) : 8;
+    concurrent_scapegoat<int> concurrent;
+    scapegoat<int> plain;
+    mutex lock;
+    // Even keys, inserted in random order; the writer toggles odd ones
+    vector<int> values(keys);
+    for(int i = 0; i < keys; i++)
+        values[i] = 2 * i;
+    shuffle(values.begin(), values.end(), mt19937(3));
+    for(int v: values)
+    {
+        concurrent.insert(v);
+        plain.insert(v);
+    }
+    printf("%d keys, %u hardware threads, reads in M/s\n", keys, thread::hardware_concurrency());
+    printf("  readers  concurrent  mutex\n");
+    for(unsigned threads = 1; threads <= max_threads; threads *= 2)
+    {
+        double a = run(threads, keys, [&](int v) { return concurrent.find(v); }, [&](int v)
+        {
+            if(v & 1)
+                concurrent.insert(v);
+            else
+                concurrent.erase(v + 1);
+        });
+        double b = run(threads, keys, [&](int v)
+        {
+            lock_guard<mutex> guard(lock);
+            return plain.find(v);
+        }, [&](int v)
+        {
+            lock_guard<mutex> guard(lock);
+            if(v & 1)
+                plain.insert(v);
+            else
+                plain.erase(v + 1);
+        });
+        printf("  %7u  %10.2f  %5.2f\n", threads, a, b);
+    }
+}
@@ -0,0 +1,58 @@
+/*
+ * Per-insert latency of scapegoat: N random or increasing keys are inserted
+ * one at a time, timing each insert, and the percentiles are reported for
+ * every layout. The tail is where rebuilds show up. Build and run from the
+ * repository root:
+ *   g++ -std=c++17 -O2 bench/scapegoat_latency.cpp -o scapegoat_latency && ./scapegoat_latency [N]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "../scapegoat.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+template<typename Layout>
+static void run(const char* name, const vector<int>& keys)
+{
+    scapegoat<int, Layout> tree;
+    vector<double> latency(keys.size());
+    for(size_t i = 0; i < keys.size(); i++)
+    {
+        auto start = chrono::steady_clock::now();
+        tree.insert(keys[i]);
+        latency[i] = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+    }
+    double total = 0;
+    for(double x : latency)
+        total += x;
+    sort(latency.begin(), latency.end());
+    size_t n = latency.size();
+    printf("  %-18s total %7.0f ms   p50 %6.2f us   p99 %6.2f us   p99.9 %6.2f us   max %8.0f us\n", name,
+           total / 1e3, latency[n / 2], latency[n * 99 / 100], latency[n * 999 / 1000], latency.back());
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? atoi(argv[1]) : 1000000;
+    vector<int> keys(n);
+    mt19937 r(1);
+    for(int& x : keys)
+        x = r();
+    for(int sorted = 0; sorted < 2; sorted++)
+    {
+        if(sorted)
+            for(size_t i = 0; i < n; i++)
+                keys[i] = i;
+        printf("%zu %s keys\n", n, sorted ? "increasing" : "random");
+        run<policy::allocation_order>("allocation_order", keys);
+        run<policy::bfs_order>("bfs_order", keys);
+        run<policy::veb_order>("veb_order", keys);
+    }
+}
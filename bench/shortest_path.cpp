@@ -0,0 +1,145 @@
+/*
+ * Compares the priority queues of shortest_paths() and astar() on a
+ * road-like grid and on a random graph, reporting time, relaxed arcs per
+ * second and the peak heap used by the search. Build and run from the
+ * repository root:
+ *   g++ -std=c++17 -O2 bench/shortest_path.cpp -o shortest_path && ./shortest_path [grid_side [random_vertices random_arcs]]
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+
+#include "../shortest_path.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+// Every allocation is counted, the size stored in front of the block. GCC
+// inlines these into std::allocator and then flags the access in front of
+// the pointer it got from operator new as out of bounds.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#endif
+static size_t allocated = 0, peak = 0;
+
+void* operator new(size_t n)
+{
+    char* p = static_cast<char*>(malloc(n + 16));
+    if(!p)
+        throw bad_alloc();
+    memcpy(p, &n, sizeof(n));
+    allocated += n;
+    peak = max(peak, allocated);
+    return p + 16;
+}
+
+void operator delete(void* p) noexcept
+{
+    if(!p)
+        return;
+    char* q = static_cast<char*>(p) - 16;
+    size_t n;
+    memcpy(&n, q, sizeof(n));
+    allocated -= n;
+    free(q);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    operator delete(p);
+}
+
+typedef vector<tuple<size_t, size_t, uint64_t>> edge_list;
+
+// Side x side grid with arcs both ways, weights 1..100
+static edge_list grid(size_t side)
+{
+    mt19937 r(1);
+    edge_list e;
+    for(size_t y = 0; y < side; y++)
+    {
+        for(size_t x = 0; x < side; x++)
+        {
+            size_t v = y * side + x;
+            if(x + 1 < side)
+            {
+                e.emplace_back(v, v + 1, r() % 100 + 1);
+                e.emplace_back(v + 1, v, r() % 100 + 1);
+            }
+            if(y + 1 < side)
+            {
+                e.emplace_back(v, v + side, r() % 100 + 1);
+                e.emplace_back(v + side, v, r() % 100 + 1);
+            }
+        }
+    }
+    return e;
+}
+
+static edge_list random_graph(size_t n, size_t m)
+{
+    mt19937 r(1);
+    edge_list e;
+    e.reserve(m);
+    for(size_t i = 0; i < m; i++)
+        e.emplace_back(r() % n, r() % n, r() % 1000 + 1);
+    return e;
+}
+
+// Times `search`, which returns a checksum, and prints the line for `name`
+template<typename F>
+static void report(const char* name, size_t arcs, F search)
+{
+    size_t base = allocated;
+    peak = allocated;
+    auto start = chrono::steady_clock::now();
+    uint64_t checksum = search();
+    double time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("  %-9s %8.0f ms %6.1f M arcs/s %5zu MB  (%llu)\n", name, time * 1e3, arcs / time / 1e6, (peak - base) >> 20, (unsigned long long)checksum);
+}
+
+template<typename U>
+static uint64_t all_distances(const csr_graph<uint64_t>& g)
+{
+    uint64_t sum = 0;
+    for(uint64_t d: shortest_paths<uint64_t, U>(g, 0))
+    {
+        if(d != numeric_limits<uint64_t>::max())
+            sum += d;
+    }
+    return sum;
+}
+
+int main(int argc, char** argv)
+{
+    size_t side = argc > 1 ? atoi(argv[1]) : 1000;
+    size_t n = argc > 3 ? atoi(argv[2]) : 1000000;
+    size_t m = argc > 3 ? atoi(argv[3]) : 10000000;
+    {
+        csr_graph<uint64_t> g(side * side, grid(side));
+        size_t arcs = g.end(g.size() - 1);
+        printf("grid %zux%zu, %zu arcs, shortest_paths from a corner\n", side, side, arcs);
+        report("pairing", arcs, [&]() { return all_distances<policy::pairing>(g); });
+        report("binomial", arcs, [&]() { return all_distances<policy::binomial>(g); });
+        report("lazy", arcs, [&]() { return all_distances<policy::lazy>(g); });
+        // Weights are at least 1, so the Manhattan distance is consistent
+        size_t target = side * side - 1;
+        auto manhattan = [side](size_t v) { return uint64_t(2 * side - 2 - v % side - v / side); };
+        printf("grid %zux%zu, astar corner to corner\n", side, side);
+        report("pairing", arcs, [&]() { return astar<uint64_t, policy::pairing>(g, 0, target, manhattan); });
+        report("binomial", arcs, [&]() { return astar<uint64_t, policy::binomial>(g, 0, target, manhattan); });
+        report("lazy", arcs, [&]() { return astar<uint64_t, policy::lazy>(g, 0, target, manhattan); });
+    }
+    {
+        csr_graph<uint64_t> g(n, random_graph(n, m));
+        printf("random graph, %zu vertices, %zu arcs, shortest_paths from vertex 0\n", n, m);
+        report("pairing", m, [&]() { return all_distances<policy::pairing>(g); });
+        report("binomial", m, [&]() { return all_distances<policy::binomial>(g); });
+        report("lazy", m, [&]() { return all_distances<policy::lazy>(g); });
+    }
+}
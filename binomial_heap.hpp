@@ -7,97 +7,137 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "heap_pool.hpp"
+
 namespace ostuni
 {
-template <typename T>
-class binomial_heap
+// Min-heap with respect to Compare, so std::greater<T> gives a max-heap
+template <typename T, typename Compare = std::less<T>, typename Allocator = std::allocator<T>>
+class binomial_heap : protected _heap_compare<Compare>
 {
 protected:
-    template <typename U>
-    class binomial_heap_element;
-    friend binomial_heap_element<T>;
-    binomial_heap(const std::vector<std::shared_ptr<binomial_heap_element<T>>>& v)
-    {
-        nodes = v;
-    }
-    template <typename U>
+    typedef _heap_compare<Compare> compare_base;
+    using compare_base::comp;
+    // Trees are stored left-child/right-sibling: the children of a node are
+    // linked through `sibling`, starting from the one with the highest degree.
+    // `prev` points to the left sibling, or to the parent for the first child
+    // (it is null for roots).
     class binomial_heap_element
     {
-    protected:
-        std::vector<std::shared_ptr<binomial_heap_element<U>>> children;
-        U value;
-        size_t getDegree()
+    public:
+        T value;
+        binomial_heap_element* child;
+        binomial_heap_element* sibling;
+        binomial_heap_element* prev;
+        size_t degree;
+        template <typename... Args>
+        binomial_heap_element(Args&&... args) : value(std::forward<Args>(args)...)
+        {
+            child = nullptr;
+            sibling = nullptr;
+            prev = nullptr;
+            degree = 0;
+        }
+        void attachElement(binomial_heap_element* e)
         {
-            return children.size();
+            assert(degree == e->degree);
+            e->sibling = child;
+            e->prev = this;
+            if(child)
+                child->prev = e;
+            child = e;
+            degree++;
         }
-        void attachElement(std::shared_ptr<binomial_heap_element<U>> e)
+        // Walks left to the first sibling, so the cost is the number of
+        // children of the parent with a higher degree than this element
+        binomial_heap_element* getParent() const
         {
-            assert(getDegree() == e->getDegree());
-            children.push_back(e);
+            const binomial_heap_element* e = this;
+            while(e->prev && e->prev->child != e)
+                e = e->prev;
+            return e->prev;
         }
-        binomial_heap<U> dismantle()
+    };
+
+public:
+    class handle_type
+    {
+    protected:
+        binomial_heap_element* element;
+        handle_type(binomial_heap_element* e)
         {
-            return binomial_heap<U>(children);
+            element = e;
         }
 
     public:
-        binomial_heap_element(const U& v)
+        handle_type()
+        {
+            element = nullptr;
+        }
+        const T& operator*() const
         {
-            value = v;
+            assert(element);
+            return element->value;
         }
-        friend class binomial_heap<U>;
+        bool operator==(const handle_type& o) const
+        {
+            return element == o.element;
+        }
+        bool operator!=(const handle_type& o) const
+        {
+            return element != o.element;
+        }
+        friend class binomial_heap;
     };
-    binomial_heap(const T& v)
-    {
-        nodes.push_back(std::make_shared<binomial_heap_element<T>>(v));
-    }
-    std::vector<std::shared_ptr<binomial_heap_element<T>>> nodes;
-    long int getMinIndex()
+
+protected:
+    _heap_pool<binomial_heap_element, Allocator> pool;
+    std::vector<binomial_heap_element*> nodes;
+    // Root holding the minimum, kept up to date by every operation
+    binomial_heap_element* min_element;
+    size_t element_count;
+    // Reused by pop() to hold the children of the removed root
+    std::vector<binomial_heap_element*> scratch;
+    binomial_heap_element* findMin() const
     {
-        long int min_index = -1;
+        binomial_heap_element* m = nullptr;
         for(size_t i = 0; i < nodes.size(); i++)
         {
-            if(nodes[i])
-            {
-                if(min_index < 0)
-                    min_index = i;
-                if(nodes[i]->value < nodes[min_index]->value)
-                    min_index = i;
-            }
+            if(nodes[i] && (!m || comp()(nodes[i]->value, m->value)))
+                m = nodes[i];
         }
-        return min_index;
+        return m;
     }
-
-public:
-    bool empty()
+    binomial_heap_element* link(binomial_heap_element* e1, binomial_heap_element* e2)
     {
-        return !size();
+        assert(e1 && e2);
+        if(comp()(e1->value, e2->value))
+            std::swap(e1, e2);
+        // The winner is never greater than the loser, so if the minimum
+        // stops being a root its new parent holds the same value
+        e2->attachElement(e1);
+        if(min_element == e1)
+            min_element = e2;
+        return e2;
     }
-    void merge(binomial_heap& bh)
+    // Adds the binomial trees in `v` (indexed by degree) to the heap and
+    // clears `v`. The elements must already belong to `pool`.
+    void mergeRoots(std::vector<binomial_heap_element*>& v)
     {
-        auto m = [](std::shared_ptr<binomial_heap_element<T>> e1, std::shared_ptr<binomial_heap_element<T>> e2) -> auto
-        {
-            assert(e1 && e2);
-            if(e1->value < e2->value)
-            {
-                e1->attachElement(e2);
-                return e1;
-            }
-            else
-            {
-                e2->attachElement(e1);
-                return e2;
-            }
-        };
-        std::shared_ptr<binomial_heap_element<T>> tmp;
+        binomial_heap_element* tmp = nullptr;
         size_t i;
-        for(i = 0; i < bh.nodes.size(); i++)
+        for(i = 0; i < v.size(); i++)
         {
-            if(bh.nodes[i] || tmp)
+            if(v[i] || tmp)
             {
                 if(nodes.size() <= i)
                 {
@@ -105,35 +145,35 @@ public:
                 }
                 if(!nodes[i])
                 {
-                    if(bh.nodes[i] && tmp)
+                    if(v[i] && tmp)
                     {
-                        tmp = m(bh.nodes[i], tmp);
+                        tmp = link(v[i], tmp);
                     }
-                    else if(bh.nodes[i])
+                    else if(v[i])
                     {
-                        nodes[i] = bh.nodes[i];
+                        nodes[i] = v[i];
                     }
                     else
                     {
                         nodes[i] = tmp;
-                        tmp.reset();
+                        tmp = nullptr;
                     }
                 }
                 else
                 {
-                    if(bh.nodes[i] && tmp)
+                    if(v[i] && tmp)
                     {
-                        tmp = m(bh.nodes[i], tmp);
+                        tmp = link(v[i], tmp);
                     }
-                    else if(bh.nodes[i])
+                    else if(v[i])
                     {
-                        tmp = m(bh.nodes[i], nodes[i]);
-                        nodes[i].reset();
+                        tmp = link(v[i], nodes[i]);
+                        nodes[i] = nullptr;
                     }
                     else
                     {
-                        tmp = m(tmp, nodes[i]);
-                        nodes[i].reset();
+                        tmp = link(tmp, nodes[i]);
+                        nodes[i] = nullptr;
                     }
                 }
             }
@@ -147,48 +187,314 @@ public:
             if(!nodes[i])
             {
                 nodes[i] = tmp;
-                tmp.reset();
+                tmp = nullptr;
             }
             else
             {
-                tmp = m(tmp, nodes[i]);
-                nodes[i].reset();
+                tmp = link(tmp, nodes[i]);
+                nodes[i] = nullptr;
             }
             i++;
         }
-        bh.nodes.clear();
+        v.clear();
     }
-    T top()
+    // Inserts a single tree of degree 0 in `roots`, carrying like a binary
+    // counter: n insertions cost O(n) links overall
+    void insertElement(std::vector<binomial_heap_element*>& roots, binomial_heap_element* e)
     {
-        auto min_index = getMinIndex();
-        assert(min_index >= 0);
-        return nodes[min_index]->value;
+        size_t i = 0;
+        while(i < roots.size() && roots[i])
+        {
+            e = link(e, roots[i]);
+            roots[i] = nullptr;
+            i++;
+        }
+        if(i == roots.size())
+            roots.push_back(e);
+        else
+            roots[i] = e;
     }
-    void pop()
+    binomial_heap_element* cloneTree(const binomial_heap_element* e)
     {
-        auto min_index = getMinIndex();
-        assert(min_index >= 0);
-        auto b_tmp = nodes[min_index]->dismantle();
-        nodes[min_index].reset();
-        merge(b_tmp);
+        binomial_heap_element* c = pool.create(e->value);
+        binomial_heap_element** last = &c->child;
+        binomial_heap_element* prev = c;
+        try
+        {
+            for(const binomial_heap_element* i = e->child; i; i = i->sibling)
+            {
+                *last = cloneTree(i);
+                (*last)->prev = prev;
+                prev = *last;
+                last = &(*last)->sibling;
+            }
+        }
+        catch(...)
+        {
+            destroyTree(c);
+            throw;
+        }
+        c->degree = e->degree;
+        return c;
     }
-    void push(const T& x)
+    // Exchanges the positions of `e` and its parent, leaving both values
+    // (and thus the handles pointing at them) untouched
+    void swapWithParent(binomial_heap_element* e)
     {
-        binomial_heap<T> b_tmp(x);
-        merge(b_tmp);
+        binomial_heap_element* p = e->getParent();
+        assert(p);
+        binomial_heap_element* p_prev = p->prev;
+        binomial_heap_element* p_sibling = p->sibling;
+        binomial_heap_element* p_child = p->child;
+        binomial_heap_element* e_prev = e->prev;
+        binomial_heap_element* e_sibling = e->sibling;
+        binomial_heap_element* e_child = e->child;
+        std::swap(e->degree, p->degree);
+        // e takes the place of p
+        e->prev = p_prev;
+        e->sibling = p_sibling;
+        if(!p_prev)
+            nodes[e->degree] = e;
+        else if(p_prev->child == p)
+            p_prev->child = e;
+        else
+            p_prev->sibling = e;
+        if(p_sibling)
+            p_sibling->prev = e;
+        // p takes the place of e among the children of e
+        if(p_child == e)
+        {
+            e->child = p;
+            p->prev = e;
+        }
+        else
+        {
+            e->child = p_child;
+            p_child->prev = e;
+            e_prev->sibling = p;
+            p->prev = e_prev;
+        }
+        p->sibling = e_sibling;
+        if(e_sibling)
+            e_sibling->prev = p;
+        // p adopts the children of e
+        p->child = e_child;
+        if(e_child)
+            e_child->prev = p;
     }
-    size_t size()
+    // Moves `e` up while it is smaller than its parent, or up to the root if
+    // `to_root` is set
+    void bubbleUp(binomial_heap_element* e, bool to_root)
     {
-        size_t s = 0;
-        for(size_t i = 0; i < nodes.size(); i++)
+        binomial_heap_element* p;
+        while((p = e->getParent()) && (to_root || comp()(e->value, p->value)))
+            swapWithParent(e);
+    }
+    // Removes the root `e`, spreading its children back among the roots
+    void removeRoot(binomial_heap_element* e)
+    {
+        assert(nodes[e->degree] == e);
+        nodes[e->degree] = nullptr;
+        scratch.resize(e->degree);
+        for(binomial_heap_element* i = e->child; i;)
+        {
+            binomial_heap_element* next = i->sibling;
+            i->sibling = nullptr;
+            i->prev = nullptr;
+            scratch[i->degree] = i;
+            i = next;
+        }
+        pool.destroy(e);
+        element_count--;
+        min_element = nullptr;
+        mergeRoots(scratch);
+        min_element = findMin();
+    }
+    void destroyTree(binomial_heap_element* e)
+    {
+        std::vector<binomial_heap_element*> stack(1, e);
+        while(!stack.empty())
+        {
+            binomial_heap_element* tmp = stack.back();
+            stack.pop_back();
+            for(binomial_heap_element* i = tmp->child; i; i = i->sibling)
+                stack.push_back(i);
+            pool.destroy(tmp);
+        }
+    }
+
+public:
+    bool empty() const
+    {
+        return !element_count;
+    }
+    void merge(binomial_heap& bh)
+    {
+        if(&bh == this)
+            return;
+        pool.splice(bh.pool);
+        if(bh.min_element && (!min_element || comp()(bh.min_element->value, min_element->value)))
+            min_element = bh.min_element;
+        element_count += bh.element_count;
+        bh.min_element = nullptr;
+        bh.element_count = 0;
+        mergeRoots(bh.nodes);
+    }
+    const T& top() const
+    {
+        assert(min_element);
+        return min_element->value;
+    }
+    // Returns the removed value, moved out of its element
+    T pop()
+    {
+        assert(min_element);
+        T x = std::move(min_element->value);
+        removeRoot(min_element);
+        return x;
+    }
+    // The returned handle stays valid until its element is removed, also
+    // across merges into another heap
+    handle_type push(const T& x)
+    {
+        return emplace(x);
+    }
+    handle_type push(T&& x)
+    {
+        return emplace(std::move(x));
+    }
+    template <typename... Args>
+    handle_type emplace(Args&&... args)
+    {
+        binomial_heap_element* e = pool.create(std::forward<Args>(args)...);
+        if(!min_element || comp()(e->value, min_element->value))
+            min_element = e;
+        element_count++;
+        insertElement(nodes, e);
+        return handle_type(e);
+    }
+    // Builds the trees for the new values on their own in O(k) and merges
+    // them in with a single carry pass. Values are constructed from `*first`
+    // as is, so wrap the range in std::make_move_iterator to move them.
+    template <typename InputIt>
+    void push_range(InputIt first, InputIt last)
+    {
+        if constexpr(std::is_base_of<std::forward_iterator_tag,
+                                     typename std::iterator_traits<InputIt>::iterator_category>::value)
+            pool.reserve(std::distance(first, last));
+        scratch.clear();
+        try
+        {
+            for(; first != last; ++first)
+            {
+                insertElement(scratch, pool.create(*first));
+                element_count++;
+            }
+        }
+        catch(...)
         {
-            if(nodes[i])
-                s += 1 << nodes[i]->getDegree();
+            min_element = nullptr;
+            mergeRoots(scratch);
+            min_element = findMin();
+            throw;
         }
-        return s;
+        min_element = nullptr;
+        mergeRoots(scratch);
+        min_element = findMin();
+    }
+    void decrease_key(handle_type h, T x)
+    {
+        binomial_heap_element* e = h.element;
+        assert(e && !comp()(e->value, x));
+        e->value = std::move(x);
+        bubbleUp(e, false);
+        if(comp()(e->value, min_element->value))
+            min_element = e;
+    }
+    void erase(handle_type h)
+    {
+        binomial_heap_element* e = h.element;
+        assert(e);
+        bubbleUp(e, true);
+        removeRoot(e);
+    }
+    size_t size() const
+    {
+        return element_count;
+    }
+    void clear()
+    {
+        for(auto& i: nodes)
+        {
+            if(i)
+                destroyTree(i);
+            i = nullptr;
+        }
+        nodes.clear();
+        min_element = nullptr;
+        element_count = 0;
+    }
+    Allocator get_allocator() const
+    {
+        return pool.get_allocator();
+    }
+    Compare value_comp() const
+    {
+        return comp();
+    }
+    void swap(binomial_heap& bh)
+    {
+        compare_base::swap(bh);
+        pool.swap(bh.pool);
+        nodes.swap(bh.nodes);
+        std::swap(min_element, bh.min_element);
+        std::swap(element_count, bh.element_count);
+    }
+    binomial_heap(const Compare& c = Compare(), const Allocator& alloc = Allocator()) : compare_base(c), pool(alloc)
+    {
+        min_element = nullptr;
+        element_count = 0;
+    }
+    template <typename InputIt>
+    binomial_heap(InputIt first, InputIt last, const Compare& c = Compare(), const Allocator& alloc = Allocator())
+        : binomial_heap(c, alloc)
+    {
+        push_range(first, last);
+    }
+    binomial_heap(const binomial_heap& bh) : binomial_heap(bh.value_comp(), bh.get_allocator())
+    {
+        nodes.resize(bh.nodes.size());
+        try
+        {
+            for(size_t i = 0; i < bh.nodes.size(); i++)
+            {
+                if(bh.nodes[i])
+                    nodes[i] = cloneTree(bh.nodes[i]);
+            }
+        }
+        catch(...)
+        {
+            clear();
+            throw;
+        }
+        min_element = findMin();
+        element_count = bh.element_count;
+    }
+    binomial_heap(binomial_heap&& bh) : binomial_heap(bh.value_comp(), bh.get_allocator())
+    {
+        swap(bh);
+    }
+    binomial_heap& operator=(binomial_heap bh)
+    {
+        swap(bh);
+        return *this;
     }
-    binomial_heap()
+    ~binomial_heap()
     {
+        // The slabs are released by the pool, so trivially destructible
+        // values need no traversal at all
+        if(!std::is_trivially_destructible<T>::value)
+            clear();
     }
 };
 }
@@ -7,142 +7,390 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
-#include <memory>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace ostuni
 {
-template <typename T>
+namespace policy
+{
+// Balancing strategies for bst
+
+// Plain binary search tree, the shape depends on the insertion order
+class unbalanced
+{
+};
+
+// AVL tree, the heights of the two subtrees of every node differ by at most one
+class avl
+{
+};
+}
+
+template <typename T, typename Balance = policy::unbalanced>
 class bst
 {
 protected:
-    template <typename U>
+    static constexpr bool balanced = std::is_same<Balance, policy::avl>::value;
+    // Nodes live in `nodes` and refer to each other by index, -1 meaning none
     class bst_node
     {
     public:
-        U value;
-        std::shared_ptr<bst_node<T>> left;
-        std::shared_ptr<bst_node<T>> right;
-        std::weak_ptr<bst_node<T>> parent;
-        bst_node()
+        T value;
+        int left;
+        int right;
+        int parent;
+        // Height of the subtree, only maintained by policy::avl
+        int height;
+        bst_node(const T& v) : value(v)
         {
-            value = U();
-            left.reset();
-            right.reset();
-            parent.reset();
+            left = -1;
+            right = -1;
+            parent = -1;
+            height = 1;
         }
     };
-    std::shared_ptr<bst_node<T>> root;
-    std::shared_ptr<bst_node<T>> _search(const T& value, std::shared_ptr<bst_node<T>> node)
+    std::vector<bst_node> nodes;
+    int root;
+    // Erased nodes, linked through `right`
+    int free_list;
+    size_t node_count;
+    int _search(const T& value) const
+    {
+        int node = root;
+        while(node != -1)
+        {
+            if(value < nodes[node].value)
+                node = nodes[node].left;
+            else if(nodes[node].value < value)
+                node = nodes[node].right;
+            else
+                return node;
+        }
+        return -1;
+    }
+    int _get_free_node(const T& value)
     {
-        if(!node)
-            return std::shared_ptr<bst_node<T>>();
-        if(value == node->value)
-            return node;
-        if(value < node->value)
-            return _search(value, node->left);
-        return _search(value, node->right);
+        if(free_list != -1)
+        {
+            int tmp = free_list;
+            free_list = nodes[tmp].right;
+            nodes[tmp] = bst_node(value);
+            return tmp;
+        }
+        nodes.push_back(bst_node(value));
+        return nodes.size() - 1;
+    }
+    // Puts `child` (possibly -1) in place of `node` under the parent of `node`
+    void _replace(int node, int child)
+    {
+        int parent = nodes[node].parent;
+        if(child != -1)
+            nodes[child].parent = parent;
+        if(parent == -1)
+            root = child;
+        else if(nodes[parent].left == node)
+            nodes[parent].left = child;
+        else
+            nodes[parent].right = child;
+    }
+    int _height(int node) const
+    {
+        return node == -1 ? 0 : nodes[node].height;
     }
-    void _erase(std::shared_ptr<bst_node<T>> node)
+    void _update_height(int node)
     {
-        if(!node->right && !node->left)
+        nodes[node].height = std::max(_height(nodes[node].left), _height(nodes[node].right)) + 1;
+    }
+    // Lifts the right child of `node` in its place and returns it
+    int _rotate_left(int node)
+    {
+        int tmp = nodes[node].right;
+        nodes[node].right = nodes[tmp].left;
+        if(nodes[tmp].left != -1)
+            nodes[nodes[tmp].left].parent = node;
+        _replace(node, tmp);
+        nodes[tmp].left = node;
+        nodes[node].parent = tmp;
+        _update_height(node);
+        _update_height(tmp);
+        return tmp;
+    }
+    // Lifts the left child of `node` in its place and returns it
+    int _rotate_right(int node)
+    {
+        int tmp = nodes[node].left;
+        nodes[node].left = nodes[tmp].right;
+        if(nodes[tmp].right != -1)
+            nodes[nodes[tmp].right].parent = node;
+        _replace(node, tmp);
+        nodes[tmp].right = node;
+        nodes[node].parent = tmp;
+        _update_height(node);
+        _update_height(tmp);
+        return tmp;
+    }
+    // Restores the AVL invariant from `node` up to the root
+    void _rebalance(int node)
+    {
+        while(node != -1)
         {
-            auto parent = node->parent.lock();
-            if(parent->right && (parent->right->value == node->value))
-                parent->right.reset();
+            int left = nodes[node].left;
+            int right = nodes[node].right;
+            int balance = _height(left) - _height(right);
+            if(balance > 1)
+            {
+                if(_height(nodes[left].left) < _height(nodes[left].right))
+                    _rotate_left(left);
+                node = _rotate_right(node);
+            }
+            else if(balance < -1)
+            {
+                if(_height(nodes[right].right) < _height(nodes[right].left))
+                    _rotate_right(right);
+                node = _rotate_left(node);
+            }
             else
-                parent->left.reset();
-            return;
+            {
+                _update_height(node);
+            }
+            node = nodes[node].parent;
         }
-        if(node->right)
+    }
+    void _erase(int node)
+    {
+        if(nodes[node].left != -1 && nodes[node].right != -1)
         {
-            auto tmp = node->right;
-            while(tmp->left)
-                tmp = tmp->left;
-            swap(node->value, tmp->value);
-            _erase(tmp);
-            return;
+            int tmp = nodes[node].right;
+            while(nodes[tmp].left != -1)
+                tmp = nodes[tmp].left;
+            std::swap(nodes[node].value, nodes[tmp].value);
+            node = tmp;
         }
-        else if(node->left)
+        int parent = nodes[node].parent;
+        _replace(node, nodes[node].left != -1 ? nodes[node].left : nodes[node].right);
+        nodes[node].right = free_list;
+        free_list = node;
+        node_count--;
+        if(balanced)
+            _rebalance(parent);
+    }
+    int _leftmost(int node) const
+    {
+        if(node != -1)
         {
-            auto tmp = node->left;
-            while(tmp->right)
-                tmp = tmp->right;
-            swap(node->value, tmp->value);
-            _erase(tmp);
-            return;
+            while(nodes[node].left != -1)
+                node = nodes[node].left;
         }
-        else
+        return node;
+    }
+    int _rightmost(int node) const
+    {
+        if(node != -1)
         {
-            assert(!!!"Something went wrong!");
+            while(nodes[node].right != -1)
+                node = nodes[node].right;
         }
+        return node;
+    }
+    int _next(int node) const
+    {
+        if(nodes[node].right != -1)
+            return _leftmost(nodes[node].right);
+        while(nodes[node].parent != -1 && nodes[nodes[node].parent].right == node)
+            node = nodes[node].parent;
+        return nodes[node].parent;
+    }
+    int _prev(int node) const
+    {
+        if(nodes[node].left != -1)
+            return _rightmost(nodes[node].left);
+        while(nodes[node].parent != -1 && nodes[nodes[node].parent].left == node)
+            node = nodes[node].parent;
+        return nodes[node].parent;
+    }
+    // First node whose value is not less than (or, if `strict`, greater
+    // than) `value`
+    int _bound(const T& value, bool strict) const
+    {
+        int node = root;
+        int result = -1;
+        while(node != -1)
+        {
+            if(strict ? value < nodes[node].value : !(nodes[node].value < value))
+            {
+                result = node;
+                node = nodes[node].left;
+            }
+            else
+            {
+                node = nodes[node].right;
+            }
+        }
+        return result;
     }
 
 public:
+    // In-order iterator over the values. Inserting keeps iterators valid,
+    // erasing invalidates all of them.
+    class iterator
+    {
+    protected:
+        const bst* tree;
+        int node;
+        iterator(const bst* t, int n)
+        {
+            tree = t;
+            node = n;
+        }
+
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+        iterator()
+        {
+            tree = nullptr;
+            node = -1;
+        }
+        reference operator*() const
+        {
+            return tree->nodes[node].value;
+        }
+        pointer operator->() const
+        {
+            return &tree->nodes[node].value;
+        }
+        iterator& operator++()
+        {
+            node = tree->_next(node);
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        // Decrementing end() gives the largest value
+        iterator& operator--()
+        {
+            node = node == -1 ? tree->_rightmost(tree->root) : tree->_prev(node);
+            return *this;
+        }
+        iterator operator--(int)
+        {
+            iterator tmp = *this;
+            --*this;
+            return tmp;
+        }
+        bool operator==(const iterator& o) const
+        {
+            return node == o.node;
+        }
+        bool operator!=(const iterator& o) const
+        {
+            return node != o.node;
+        }
+        friend class bst;
+    };
+    typedef iterator const_iterator;
     bst()
     {
-        root.reset();
+        root = -1;
+        free_list = -1;
+        node_count = 0;
     }
     bool erase(const T& value)
     {
-        auto tmp = _search(value, root);
-        if(!tmp)
+        int tmp = _search(value);
+        if(tmp == -1)
             return false;
-        if((tmp->value == root->value) && !root->right && !root->left)
-        {
-            root.reset();
-            return true;
-        }
         _erase(tmp);
         return true;
     }
     bool insert(const T& value)
     {
-        std::shared_ptr<bst_node<T>> tmp = std::make_shared<bst_node<T>>();
-        tmp->value = value;
-        if(!root)
-        {
-            root = tmp;
-            return true;
-        }
-        std::shared_ptr<bst_node<T>> last_node = root;
-        while(true)
+        int parent = -1;
+        int node = root;
+        bool left = false;
+        while(node != -1)
         {
-            if(value > last_node->value)
-            {
-                if(last_node->right)
-                {
-                    last_node = last_node->right;
-                }
-                else
-                {
-                    last_node->right = tmp;
-                    tmp->parent = last_node;
-                    return true;
-                }
-            }
-            else if(value < last_node->value)
-            {
-                if(last_node->left)
-                {
-                    last_node = last_node->left;
-                }
-                else
-                {
-                    last_node->left = tmp;
-                    tmp->parent = last_node;
-                    return true;
-                }
-            }
+            parent = node;
+            left = value < nodes[node].value;
+            if(left)
+                node = nodes[node].left;
+            else if(nodes[node].value < value)
+                node = nodes[node].right;
             else
-            {
                 return false;
-            }
         }
+        int tmp = _get_free_node(value);
+        nodes[tmp].parent = parent;
+        if(parent == -1)
+            root = tmp;
+        else if(left)
+            nodes[parent].left = tmp;
+        else
+            nodes[parent].right = tmp;
+        node_count++;
+        if(balanced)
+            _rebalance(parent);
+        return true;
+    }
+    bool find(const T& value) const
+    {
+        return _search(value) != -1;
+    }
+    size_t size() const
+    {
+        return node_count;
+    }
+    bool empty() const
+    {
+        return !node_count;
+    }
+    iterator begin() const
+    {
+        return iterator(this, _leftmost(root));
+    }
+    iterator end() const
+    {
+        return iterator(this, -1);
+    }
+    iterator lower_bound(const T& value) const
+    {
+        return iterator(this, _bound(value, false));
+    }
+    iterator upper_bound(const T& value) const
+    {
+        return iterator(this, _bound(value, true));
+    }
+    // Calls `f` on every value in [lo, hi), in order
+    template <typename F>
+    void for_each_in_range(const T& lo, const T& hi, F f) const
+    {
+        for(int node = _bound(lo, false); node != -1 && nodes[node].value < hi; node = _next(node))
+            f(nodes[node].value);
+    }
+    void reserve(size_t n)
+    {
+        nodes.reserve(n);
     }
-    bool find(const T& value)
+    // Drops every node at once, keeping the memory for reuse
+    void clear()
     {
-        return bool(_search(value, root));
+        nodes.clear();
+        root = -1;
+        free_list = -1;
+        node_count = 0;
     }
 };
 }
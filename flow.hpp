@@ -4,6 +4,11 @@
  *
  * Time complexity (with policy::max_label): O(V²log(V)√E)
  * Time complexity (with policy::fifo): O(V³)
+ * Time complexity (with policy::parallel): O(V²E) total work
+ * Time complexity (with policy::dinic): O(V²E)
+ * Time complexity (with policy::boykov_kolmogorov): O(V²E|C|), C the minimum cut
+ * Time complexity (min_cost_flow, with policy::cost_scaling): O(V²Elog(VC)), C the largest cost
+ * Time complexity (min_cost_flow, with policy::pairing): O(F(E + Vlog(V))), F the flow value
 */
 
 #pragma once
@@ -11,10 +16,17 @@
 #include <vector>
 #include <tuple>
 #include <cassert>
-#include <unordered_map>
 #include <algorithm>
 #include <climits>
 #include <queue>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <limits>
+#include <type_traits>
+
+#include "shortest_path.hpp"
 
 namespace ostuni {
 
@@ -78,65 +90,1777 @@ public:
     }
 };
 
+// Several threads discharging vertices at the same time, see
+// push_relabel<T, policy::parallel>
+class parallel
+{
+};
+
+// Dinic's algorithm: blocking flows along shortest augmenting paths
+class dinic
+{
+};
+
+// Boykov-Kolmogorov: two search trees grown from the source and the sink and
+// reused between augmentations, fast on low-diameter graphs
+class boykov_kolmogorov
+{
+};
+
+// Cost scaling push-relabel for min_cost_flow(); policy::pairing,
+// policy::binomial and policy::lazy pick successive shortest paths instead,
+// with that priority queue
+class cost_scaling
+{
+};
+
 }
 
-template<typename T, typename U = policy::max_label>
-static T flow(size_t n, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t source, size_t sink)
+// Residual graph in compressed sparse row form. Every input edge gets a
+// forward arc, at its tail, and a reverse arc, at its head, and each arc knows
+// the index of its partner; the arcs leaving `v` are the indices in
+// [begin(v), end(v)) and their residual capacities live in one flat array.
+template<typename T>
+class residual_graph
 {
-    using namespace std;
-    vector<unordered_map<size_t, T>> graph(n);
-    T upper_bound = T(0);
-    for(const auto& i: edges)
+protected:
+    std::vector<size_t> offset;
+    std::vector<size_t> to;
+    std::vector<size_t> rev;
+    std::vector<T> cap;
+    // Forward arc of every input edge
+    std::vector<size_t> edge_arc;
+public:
+    // `edges` holds tuples whose first three fields are tail, head and
+    // capacity, the rest is ignored
+    template<typename E>
+    residual_graph(size_t n, const std::vector<E>& edges) : offset(n + 1, 0), to(2 * edges.size()), rev(2 * edges.size()), cap(2 * edges.size(), T(0)), edge_arc(edges.size())
     {
-        graph[get<0>(i)][get<1>(i)] += get<2>(i);
-        if(get<0>(i) == source)
-            upper_bound += get<2>(i);
+        for(const auto& i: edges)
+        {
+            assert(std::get<0>(i) < n && std::get<1>(i) < n);
+            offset[std::get<0>(i) + 1]++;
+            offset[std::get<1>(i) + 1]++;
+        }
+        for(size_t i = 0; i < n; i++)
+            offset[i + 1] += offset[i];
+        std::vector<size_t> pos(offset.begin(), offset.end() - 1);
+        for(size_t i = 0; i < edges.size(); i++)
+        {
+            size_t u = std::get<0>(edges[i]);
+            size_t v = std::get<1>(edges[i]);
+            size_t forward = pos[u]++;
+            size_t backward = pos[v]++;
+            to[forward] = v;
+            to[backward] = u;
+            rev[forward] = backward;
+            rev[backward] = forward;
+            cap[forward] = std::get<2>(edges[i]);
+            edge_arc[i] = forward;
+        }
     }
-    vector<size_t> height(n);
-    vector<T> excess(n, T(0));
-    excess[source] = upper_bound;
-    U node_queue;
-    auto relabel = [&graph, &height](size_t node) -> void
+    size_t size() const
     {
-        size_t min_height = ULONG_MAX;
-        for(const auto& edge: graph[node])
+        return offset.size() - 1;
+    }
+    size_t begin(size_t v) const
+    {
+        return offset[v];
+    }
+    size_t end(size_t v) const
+    {
+        return offset[v + 1];
+    }
+    size_t target(size_t arc) const
+    {
+        return to[arc];
+    }
+    size_t reverse(size_t arc) const
+    {
+        return rev[arc];
+    }
+    T& capacity(size_t arc)
+    {
+        return cap[arc];
+    }
+    const T& capacity(size_t arc) const
+    {
+        return cap[arc];
+    }
+    // Number of input edges
+    size_t edges() const
+    {
+        return edge_arc.size();
+    }
+    // Forward arc of the i-th input edge
+    size_t arc(size_t edge) const
+    {
+        return edge_arc[edge];
+    }
+    // Sends `quantity` along `arc`
+    void push(size_t arc, T quantity)
+    {
+        cap[arc] -= quantity;
+        cap[rev[arc]] += quantity;
+    }
+    // Appends an edge, keeping the flow on the others, and returns its index.
+    // The arcs after the new ones move, so this takes O(V + E).
+    size_t add_edge(size_t u, size_t v, T capacity)
+    {
+        assert(u < size() && v < size());
+        size_t forward = _insert_arc(u, v, capacity);
+        size_t backward = _insert_arc(v, u, T(0));
+        if(forward >= backward)
+            forward++;
+        rev[forward] = backward;
+        rev[backward] = forward;
+        edge_arc.push_back(forward);
+        return edge_arc.size() - 1;
+    }
+protected:
+    // Puts a new arc at the end of the arcs of `u` and shifts every index
+    // that follows it
+    size_t _insert_arc(size_t u, size_t v, T capacity)
+    {
+        size_t p = offset[u + 1];
+        for(size_t& i: rev)
         {
-            min_height = min(min_height, height[edge.first]);
-            height[node] = min_height + 1;
+            if(i >= p)
+                i++;
         }
-    };
-    auto push = [&graph, &excess](size_t node, size_t pushed)
+        for(size_t& i: edge_arc)
+        {
+            if(i >= p)
+                i++;
+        }
+        for(size_t i = u + 1; i < offset.size(); i++)
+            offset[i]++;
+        to.insert(to.begin() + p, v);
+        rev.insert(rev.begin() + p, p);
+        cap.insert(cap.begin() + p, capacity);
+        return p;
+    }
+};
+
+// Everything a maximum flow computation finds out
+template<typename T>
+class flow_result
+{
+public:
+    T value;
+    // Flow on every input edge, in input order
+    std::vector<T> edge_flow;
+    // Whether each vertex is on the source side of the minimum cut, that is
+    // cannot reach the sink in the residual graph
+    std::vector<bool> source_side;
+    // Input edges from the source side to the sink side, all saturated
+    std::vector<size_t> cut_edges;
+};
+
+// Reads the result off the residual graph of a maximum flow: the flow on an
+// edge is the residual capacity of its reverse arc, and the sink side is
+// found by a backward breadth-first search from the sink
+template<typename T>
+static flow_result<T> _flow_result(const residual_graph<T>& graph, size_t sink, T value)
+{
+    flow_result<T> r;
+    r.value = value;
+    r.edge_flow.resize(graph.edges());
+    for(size_t i = 0; i < graph.edges(); i++)
+        r.edge_flow[i] = graph.capacity(graph.reverse(graph.arc(i)));
+    r.source_side.assign(graph.size(), true);
+    std::vector<size_t> queue(1, sink);
+    r.source_side[sink] = false;
+    for(size_t k = 0; k < queue.size(); k++)
+    {
+        size_t v = queue[k];
+        for(size_t i = graph.begin(v); i < graph.end(v); i++)
+        {
+            size_t u = graph.target(i);
+            if(r.source_side[u] && graph.capacity(graph.reverse(i)) > T(0))
+            {
+                r.source_side[u] = false;
+                queue.push_back(u);
+            }
+        }
+    }
+    for(size_t i = 0; i < graph.edges(); i++)
+    {
+        size_t forward = graph.arc(i);
+        if(r.source_side[graph.target(graph.reverse(forward))] && !r.source_side[graph.target(forward)])
+            r.cut_edges.push_back(i);
+    }
+    return r;
+}
+
+// Push-relabel maximum flow, with the global relabeling and gap heuristics.
+// Phase one computes a maximum preflow, which already gives the flow value
+// and the minimum cut; phase two returns the excess stranded on the source
+// side to the source, turning the preflow into a flow.
+template<typename T, typename U = policy::max_label>
+class push_relabel
+{
+protected:
+    residual_graph<T> graph;
+    size_t n;
+    size_t source;
+    size_t sink;
+    std::vector<size_t> height;
+    std::vector<T> excess;
+    // current[v] is the first arc of v that may still be admissible: the
+    // arcs before it stay inadmissible until v is relabeled
+    std::vector<size_t> current;
+    // The vertices below height n, source excluded, in one doubly linked list
+    // per height, so that a gap is noticed as soon as a list empties
+    std::vector<size_t> bucket;
+    std::vector<size_t> bucket_next;
+    std::vector<size_t> bucket_prev;
+    size_t max_bucket;
+    U node_queue;
+    double global_relabel_frequency;
+    // Relabeling work since the last global relabel
+    size_t work;
+    bool preflow_done;
+    bool flow_done;
+    // Breadth-first search state of _repair_deficit, kept to make each search
+    // cost only what it visits
+    std::vector<size_t> visited;
+    std::vector<size_t> visit_arc;
+    size_t visit_stamp;
+    void _bucket_insert(size_t v)
+    {
+        size_t h = height[v];
+        bucket_prev[v] = ULONG_MAX;
+        bucket_next[v] = bucket[h];
+        if(bucket[h] != ULONG_MAX)
+            bucket_prev[bucket[h]] = v;
+        bucket[h] = v;
+        max_bucket = std::max(max_bucket, h);
+    }
+    void _bucket_remove(size_t v)
+    {
+        if(bucket_prev[v] != ULONG_MAX)
+            bucket_next[bucket_prev[v]] = bucket_next[v];
+        else
+            bucket[height[v]] = bucket_next[v];
+        if(bucket_next[v] != ULONG_MAX)
+            bucket_prev[bucket_next[v]] = bucket_prev[v];
+    }
+    // Vertices whose excess becomes positive are queued, so none is ever
+    // queued twice
+    void _push(size_t node, size_t arc, T quantity)
     {
-        T quantity = min(excess[node], graph[node][pushed]);
+        size_t pushed = graph.target(arc);
+        graph.push(arc, quantity);
         excess[node] -= quantity;
+        if(excess[pushed] == T(0) && pushed != source && pushed != sink)
+            node_queue.add(pushed, height[pushed]);
         excess[pushed] += quantity;
-        graph[pushed][node] += quantity;
-        graph[node][pushed] -= quantity;
-        if(graph[node][pushed] == 0)
-            graph[node].erase(pushed);
-    };
-    auto discharge = [&graph, &n, &push, &relabel, &height, &excess, &node_queue, &sink, &source](size_t node)
+    }
+    // Nothing is left at height `h`, so nothing above it can reach the sink
+    // any more: lifts all of it to n
+    void _gap(size_t h)
+    {
+        for(size_t i = h + 1; i <= max_bucket; i++)
+        {
+            for(size_t v = bucket[i]; v != ULONG_MAX; v = bucket_next[v])
+                height[v] = n;
+            bucket[i] = ULONG_MAX;
+        }
+        max_bucket = h;
+    }
+    // Lifts `node` just above its lowest residual neighbour and points its
+    // current arc there. While looking for the preflow, heights stop at n
+    // and gaps are detected.
+    void _relabel(size_t node, bool preflow)
+    {
+        size_t old_height = height[node];
+        if(preflow)
+        {
+            _bucket_remove(node);
+            if(bucket[old_height] == ULONG_MAX)
+            {
+                _gap(old_height);
+                height[node] = n;
+                return;
+            }
+        }
+        size_t min_height = ULONG_MAX;
+        size_t min_arc = graph.end(node);
+        for(size_t i = graph.begin(node); i < graph.end(node); i++)
+        {
+            if(graph.capacity(i) > T(0) && height[graph.target(i)] < min_height)
+            {
+                min_height = height[graph.target(i)];
+                min_arc = i;
+            }
+        }
+        work += graph.end(node) - graph.begin(node) + 12;
+        height[node] = min_height + 1;
+        current[node] = min_arc;
+        if(preflow)
+        {
+            if(height[node] < n)
+                _bucket_insert(node);
+            else
+                height[node] = n;
+        }
+    }
+    void _discharge(size_t node, bool preflow)
     {
         while(excess[node] > T(0))
         {
-            for(size_t i = 0; i < n && excess[node] > T(0); i++)
+            size_t i = current[node];
+            for(; i < graph.end(node); i++)
+            {
+                if(graph.capacity(i) > T(0) && height[node] == height[graph.target(i)] + 1)
+                {
+                    _push(node, i, std::min(excess[node], graph.capacity(i)));
+                    if(excess[node] == T(0))
+                        break;
+                }
+            }
+            if(i < graph.end(node))
+            {
+                current[node] = i;
+                return;
+            }
+            _relabel(node, preflow);
+            if(preflow && height[node] >= n)
+                return;
+        }
+    }
+    // Sets every height to the exact residual distance to `root`, plus
+    // `base`, over the vertices that are at least `base` high and not the
+    // source; the ones that cannot reach `root` get `unreachable`
+    void _bfs(size_t root, size_t base, size_t unreachable)
+    {
+        std::vector<size_t> queue;
+        queue.reserve(n);
+        for(size_t v = 0; v < n; v++)
+        {
+            if(v != source && height[v] >= base)
+            {
+                height[v] = ULONG_MAX;
+                current[v] = graph.begin(v);
+            }
+        }
+        height[root] = base;
+        queue.push_back(root);
+        for(size_t k = 0; k < queue.size(); k++)
+        {
+            size_t v = queue[k];
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t u = graph.target(i);
+                if(height[u] == ULONG_MAX && graph.capacity(graph.reverse(i)) > T(0))
+                {
+                    height[u] = height[v] + 1;
+                    queue.push_back(u);
+                }
+            }
+        }
+        for(size_t v = 0; v < n; v++)
+        {
+            if(height[v] == ULONG_MAX)
+                height[v] = unreachable;
+        }
+    }
+    // Backward breadth-first search from the sink, then rebuilds the buckets
+    // and the queue of active vertices from scratch
+    void _global_relabel()
+    {
+        _bfs(sink, 0, n);
+        height[source] = n;
+        std::fill(bucket.begin(), bucket.end(), ULONG_MAX);
+        max_bucket = 0;
+        node_queue = U();
+        for(size_t v = 0; v < n; v++)
+        {
+            if(height[v] < n)
+            {
+                _bucket_insert(v);
+                if(excess[v] > T(0) && v != sink)
+                    node_queue.add(v, height[v]);
+            }
+        }
+        work = 0;
+    }
+    void _saturate_source()
+    {
+        height[source] = n;
+        for(size_t i = graph.begin(source); i < graph.end(source); i++)
+        {
+            if(graph.capacity(i) > T(0) && graph.target(i) != source)
+            {
+                excess[source] += graph.capacity(i);
+                _push(source, i, graph.capacity(i));
+            }
+        }
+    }
+    double _global_relabel_threshold() const
+    {
+        return 6.0 * n + graph.end(n - 1);
+    }
+    // `v` sends out more than it receives: pulls the difference back along
+    // residual paths from the nearest vertices that have some to give, the
+    // source and the sink included (taking it from the sink lowers the flow
+    // value). Such a path exists, since the flow leaving `v` ends somewhere.
+    void _repair_deficit(size_t v)
+    {
+        if(visited.size() != n)
+        {
+            visited.assign(n, 0);
+            visit_arc.resize(n);
+            visit_stamp = 0;
+        }
+        std::vector<size_t> queue;
+        while(excess[v] < T(0))
+        {
+            visit_stamp++;
+            visited[v] = visit_stamp;
+            queue.assign(1, v);
+            size_t giver = ULONG_MAX;
+            for(size_t k = 0; k < queue.size() && giver == ULONG_MAX; k++)
             {
-                if(graph[node].count(i) && (height[node] == height[i] + 1 || node == source))
+                size_t x = queue[k];
+                for(size_t i = graph.begin(x); i < graph.end(x); i++)
                 {
-                    push(node, i);
-                    if(i != sink && i != source)
-                        node_queue.add(i, height[i]);
+                    size_t w = graph.target(i);
+                    if(visited[w] == visit_stamp || graph.capacity(graph.reverse(i)) == T(0))
+                        continue;
+                    visited[w] = visit_stamp;
+                    visit_arc[w] = graph.reverse(i);
+                    if(w == source || w == sink || excess[w] > T(0))
+                    {
+                        giver = w;
+                        break;
+                    }
+                    queue.push_back(w);
                 }
             }
-            if(excess[node] > T(0))
-                relabel(node);
+            assert(giver != ULONG_MAX);
+            T quantity = -excess[v];
+            if(giver != source && giver != sink)
+                quantity = std::min(quantity, excess[giver]);
+            for(size_t w = giver; w != v; w = graph.target(visit_arc[w]))
+                quantity = std::min(quantity, graph.capacity(visit_arc[w]));
+            for(size_t w = giver; w != v; w = graph.target(visit_arc[w]))
+                graph.push(visit_arc[w], quantity);
+            excess[giver] -= quantity;
+            excess[v] += quantity;
+        }
+    }
+public:
+    push_relabel(size_t vertices, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t s, size_t t) : graph(vertices, edges), n(vertices), source(s), sink(t), height(vertices, 0), excess(vertices, T(0)), current(vertices), bucket(vertices, ULONG_MAX), bucket_next(vertices), bucket_prev(vertices), max_bucket(0)
+    {
+        assert(source < n && sink < n && source != sink);
+        global_relabel_frequency = 0.5;
+        work = 0;
+        preflow_done = false;
+        flow_done = false;
+        visit_stamp = 0;
+    }
+    // A global relabel runs whenever the relabeling work since the last one,
+    // times `frequency`, exceeds 6n + (number of arcs); 0 only runs the
+    // initial one
+    void set_global_relabel_frequency(double frequency)
+    {
+        assert(frequency >= 0.0);
+        global_relabel_frequency = frequency;
+    }
+    // Phase one: stops as soon as the flow value is known, leaving excess
+    // on the source side of the minimum cut
+    T max_preflow()
+    {
+        if(preflow_done)
+            return excess[sink];
+        _saturate_source();
+        const double threshold = _global_relabel_threshold();
+        _global_relabel();
+        while(!node_queue.empty())
+        {
+            size_t node = node_queue.next();
+            if(height[node] >= n || excess[node] == T(0))
+                continue;
+            _discharge(node, true);
+            if(global_relabel_frequency > 0.0 && work * global_relabel_frequency > threshold)
+                _global_relabel();
+        }
+        preflow_done = true;
+        return excess[sink];
+    }
+    // Both phases: afterwards every vertex but the source and the sink is
+    // balanced
+    T max_flow()
+    {
+        max_preflow();
+        if(flow_done)
+            return excess[sink];
+        // The vertices left with excess cannot reach the sink, so it all
+        // goes back to the source, with heights starting from n
+        _bfs(source, n, 2 * n);
+        node_queue = U();
+        for(size_t v = 0; v < n; v++)
+        {
+            if(excess[v] > T(0) && v != source && v != sink)
+                node_queue.add(v, height[v]);
+        }
+        while(!node_queue.empty())
+            _discharge(node_queue.next(), false);
+        flow_done = true;
+        return excess[sink];
+    }
+    // Changes the capacity of the i-th edge (in input order, then in the
+    // order of add_edge). If it now carries too much, the surplus stays at its
+    // tail and is pulled back to its head from nearby, so the preflow is
+    // repaired locally; the head runs a deficit meanwhile, hence signed T.
+    void set_capacity(size_t edge, T capacity)
+    {
+        static_assert(std::is_signed<T>::value, "set_capacity() needs a signed capacity type");
+        assert(edge < graph.edges() && capacity >= T(0));
+        size_t forward = graph.arc(edge);
+        size_t backward = graph.reverse(forward);
+        T quantity = graph.capacity(backward);
+        if(capacity >= quantity)
+        {
+            graph.capacity(forward) = capacity - quantity;
+        }
+        else
+        {
+            size_t u = graph.target(backward);
+            size_t v = graph.target(forward);
+            graph.capacity(forward) = T(0);
+            graph.capacity(backward) = capacity;
+            excess[u] += quantity - capacity;
+            excess[v] -= quantity - capacity;
+            if(v != source && v != sink)
+                _repair_deficit(v);
+        }
+        preflow_done = false;
+        flow_done = false;
+    }
+    // Adds an edge, in O(V + E), and returns its index
+    size_t add_edge(size_t u, size_t v, T capacity)
+    {
+        assert(capacity >= T(0));
+        preflow_done = false;
+        flow_done = false;
+        return graph.add_edge(u, v, capacity);
+    }
+    // Brings the maximum preflow up to date after set_capacity() and
+    // add_edge(), starting from the current one: the source arcs that gained
+    // capacity are saturated, a global relabel refreshes the heights and only
+    // the vertices left active are discharged. Returns the new value; call
+    // max_flow() or result() afterwards for the flow itself.
+    T resolve()
+    {
+        return max_preflow();
+    }
+    // Runs both phases, since the edge flows must be a flow
+    flow_result<T> result()
+    {
+        return _flow_result(graph, sink, max_flow());
+    }
+    const residual_graph<T>& residual() const
+    {
+        return graph;
+    }
+};
+
+template<typename T>
+static T _atomic_add(std::atomic<T>& a, T value)
+{
+    T old = a.load();
+    while(!a.compare_exchange_weak(old, old + value));
+    return old;
+}
+
+// Lock-free multithreaded push-relabel (Hong, 2008). Each thread owns the
+// vertices it takes from its work queue, pushes to the lowest residual
+// neighbour with atomic updates of capacities and excesses, and steals from
+// the other queues when its own is empty. Global relabels stop every thread
+// and run as a parallel breadth-first search; there is no gap detection.
+// The second phase of max_flow() runs on one thread. The atomic updates make
+// one thread of this engine 1.3-1.5x slower than the sequential one, so with
+// a single thread max_preflow() runs the sequential fifo solver instead;
+// bench/flow_parallel.cpp measures both.
+template<typename T>
+class push_relabel<T, policy::parallel> : public push_relabel<T, policy::fifo>
+{
+protected:
+    typedef push_relabel<T, policy::fifo> base;
+    class alignas(64) _work_queue
+    {
+    public:
+        std::mutex lock;
+        std::deque<size_t> q;
+    };
+    class _spin_barrier
+    {
+    protected:
+        std::atomic<size_t> count;
+        std::atomic<size_t> generation;
+        size_t threads;
+    public:
+        _spin_barrier(size_t t) : count(0), generation(0), threads(t)
+        {
+        }
+        void wait()
+        {
+            size_t g = generation.load();
+            if(count.fetch_add(1) + 1 == threads)
+            {
+                count.store(0);
+                generation.fetch_add(1);
+            }
+            else
+            {
+                while(generation.load() == g)
+                    std::this_thread::yield();
+            }
         }
     };
-    height[source] = n;
-    node_queue.add(source, height[source]);
-    while(!node_queue.empty())
-        discharge(node_queue.next());
-    return excess[sink];
+    size_t threads;
+    std::vector<std::atomic<T>> shared_cap;
+    std::vector<std::atomic<T>> shared_excess;
+    std::vector<std::atomic<size_t>> shared_height;
+    // Set while a vertex is queued or being discharged, so that only one
+    // thread at a time works on it
+    std::vector<std::atomic<bool>> active;
+    // Number of vertices with `active` set
+    std::atomic<size_t> pending;
+    std::atomic<size_t> work;
+    std::atomic<bool> relabel_requested;
+    std::vector<_work_queue> queues;
+    std::vector<size_t> frontier;
+    std::vector<std::vector<size_t>> next_frontier;
+    std::atomic<size_t> frontier_position;
+    bool done;
+    void _enqueue(size_t tid, size_t v)
+    {
+        std::lock_guard<std::mutex> lock(queues[tid].lock);
+        queues[tid].q.push_back(v);
+    }
+    // Takes the oldest vertex of its own queue, which keeps the FIFO order
+    // of policy::fifo, or the newest of someone else's
+    bool _dequeue(size_t tid, size_t& v)
+    {
+        for(size_t i = 0; i < threads; i++)
+        {
+            _work_queue& w = queues[(tid + i) % threads];
+            std::lock_guard<std::mutex> lock(w.lock);
+            if(!w.q.empty())
+            {
+                if(i == 0)
+                {
+                    v = w.q.front();
+                    w.q.pop_front();
+                }
+                else
+                {
+                    v = w.q.back();
+                    w.q.pop_back();
+                }
+                return true;
+            }
+        }
+        return false;
+    }
+    // Discharges the vertex `u`, owned by the calling thread
+    void _process(size_t tid, size_t u)
+    {
+        const size_t n = this->n;
+        const residual_graph<T>& graph = this->graph;
+        size_t local_work = 0;
+        while(true)
+        {
+            while(shared_excess[u].load() > T(0) && shared_height[u].load() < n)
+            {
+                size_t min_height = ULONG_MAX;
+                size_t min_arc = graph.end(u);
+                for(size_t i = graph.begin(u); i < graph.end(u); i++)
+                {
+                    if(shared_cap[i].load() > T(0) && shared_height[graph.target(i)].load() < min_height)
+                    {
+                        min_height = shared_height[graph.target(i)].load();
+                        min_arc = i;
+                    }
+                }
+                if(min_arc == graph.end(u))
+                {
+                    shared_height[u].store(n);
+                    break;
+                }
+                if(shared_height[u].load() > min_height)
+                {
+                    // Only the owner of `u` lowers its excess and the
+                    // capacities of its arcs, so the quantity stays available
+                    T quantity = std::min(shared_excess[u].load(), shared_cap[min_arc].load());
+                    size_t v = graph.target(min_arc);
+                    _atomic_add(shared_cap[min_arc], -quantity);
+                    _atomic_add(shared_cap[graph.reverse(min_arc)], quantity);
+                    _atomic_add(shared_excess[u], -quantity);
+                    _atomic_add(shared_excess[v], quantity);
+                    if(v != this->source && v != this->sink && shared_height[v].load() < n && !active[v].exchange(true))
+                    {
+                        pending.fetch_add(1);
+                        _enqueue(tid, v);
+                    }
+                }
+                else
+                {
+                    shared_height[u].store(std::min(min_height + 1, n));
+                    local_work += graph.end(u) - graph.begin(u) + 12;
+                }
+            }
+            // Someone may have pushed to `u` after the last check, before
+            // seeing it inactive
+            active[u].store(false);
+            if(shared_excess[u].load() > T(0) && shared_height[u].load() < n && !active[u].exchange(true))
+                continue;
+            pending.fetch_sub(1);
+            break;
+        }
+        work.fetch_add(local_work);
+    }
+    void _work(size_t tid)
+    {
+        const double threshold = this->_global_relabel_threshold();
+        while(!relabel_requested.load())
+        {
+            size_t v;
+            if(!_dequeue(tid, v))
+            {
+                if(pending.load() == 0)
+                    return;
+                std::this_thread::yield();
+                continue;
+            }
+            _process(tid, v);
+            if(this->global_relabel_frequency > 0.0 && work.load() * this->global_relabel_frequency > threshold)
+                relabel_requested.store(true);
+        }
+    }
+    // Every thread calls this: a level-synchronous backward breadth-first
+    // search from the sink, then each thread queues the active vertices of
+    // its own slice
+    void _parallel_global_relabel(size_t tid, _spin_barrier& barrier)
+    {
+        const size_t n = this->n;
+        const residual_graph<T>& graph = this->graph;
+        size_t first = tid * n / threads;
+        size_t last = (tid + 1) * n / threads;
+        for(size_t v = first; v < last; v++)
+        {
+            if(v != this->source)
+                shared_height[v].store(ULONG_MAX);
+            active[v].store(false);
+        }
+        queues[tid].q.clear();
+        barrier.wait();
+        if(tid == 0)
+        {
+            shared_height[this->sink].store(0);
+            frontier.assign(1, this->sink);
+            frontier_position.store(0);
+            pending.store(0);
+            work.store(0);
+            relabel_requested.store(false);
+        }
+        barrier.wait();
+        while(!frontier.empty())
+        {
+            std::vector<size_t>& found = next_frontier[tid];
+            const size_t chunk = 256;
+            for(size_t k = frontier_position.fetch_add(chunk); k < frontier.size(); k = frontier_position.fetch_add(chunk))
+            {
+                for(size_t j = k; j < std::min(k + chunk, frontier.size()); j++)
+                {
+                    size_t v = frontier[j];
+                    size_t h = shared_height[v].load() + 1;
+                    for(size_t i = graph.begin(v); i < graph.end(v); i++)
+                    {
+                        size_t u = graph.target(i);
+                        size_t unvisited = ULONG_MAX;
+                        if(shared_cap[graph.reverse(i)].load() > T(0) && shared_height[u].load() == ULONG_MAX && shared_height[u].compare_exchange_strong(unvisited, h))
+                            found.push_back(u);
+                    }
+                }
+            }
+            barrier.wait();
+            if(tid == 0)
+            {
+                frontier.clear();
+                for(auto& i: next_frontier)
+                {
+                    frontier.insert(frontier.end(), i.begin(), i.end());
+                    i.clear();
+                }
+                frontier_position.store(0);
+            }
+            barrier.wait();
+        }
+        size_t found = 0;
+        for(size_t v = first; v < last; v++)
+        {
+            if(shared_height[v].load() == ULONG_MAX)
+                shared_height[v].store(n);
+            if(v != this->source && v != this->sink && shared_height[v].load() < n && shared_excess[v].load() > T(0))
+            {
+                active[v].store(true);
+                queues[tid].q.push_back(v);
+                found++;
+            }
+        }
+        pending.fetch_add(found);
+    }
+    // Alternates work and global relabels until a global relabel finds no
+    // active vertex
+    void _worker(size_t tid, _spin_barrier& barrier)
+    {
+        while(true)
+        {
+            barrier.wait();
+            _parallel_global_relabel(tid, barrier);
+            barrier.wait();
+            if(tid == 0)
+                done = pending.load() == 0;
+            barrier.wait();
+            if(done)
+                return;
+            _work(tid);
+        }
+    }
+public:
+    push_relabel(size_t vertices, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t s, size_t t) : base(vertices, edges, s, t), threads(std::max(1u, std::thread::hardware_concurrency())), pending(0), work(0), relabel_requested(false)
+    {
+    }
+    // Number of threads used by max_preflow(), the calling one included;
+    // one means the sequential fifo solver
+    void set_threads(size_t count)
+    {
+        assert(count > 0);
+        threads = count;
+    }
+    T max_preflow()
+    {
+        const size_t n = this->n;
+        residual_graph<T>& graph = this->graph;
+        if(this->preflow_done)
+            return this->excess[this->sink];
+        if(threads == 1)
+            return base::max_preflow();
+        this->_saturate_source();
+        size_t arcs = graph.end(n - 1);
+        shared_cap = std::vector<std::atomic<T>>(arcs);
+        shared_excess = std::vector<std::atomic<T>>(n);
+        shared_height = std::vector<std::atomic<size_t>>(n);
+        active = std::vector<std::atomic<bool>>(n);
+        for(size_t i = 0; i < arcs; i++)
+            shared_cap[i].store(graph.capacity(i));
+        for(size_t v = 0; v < n; v++)
+        {
+            shared_excess[v].store(this->excess[v]);
+            shared_height[v].store(this->height[v]);
+        }
+        queues = std::vector<_work_queue>(threads);
+        next_frontier.assign(threads, std::vector<size_t>());
+        _spin_barrier barrier(threads);
+        std::vector<std::thread> pool;
+        for(size_t i = 1; i < threads; i++)
+            pool.emplace_back([this, i, &barrier]() { _worker(i, barrier); });
+        _worker(0, barrier);
+        for(auto& i: pool)
+            i.join();
+        for(size_t i = 0; i < arcs; i++)
+            graph.capacity(i) = shared_cap[i].load();
+        for(size_t v = 0; v < n; v++)
+        {
+            this->excess[v] = shared_excess[v].load();
+            this->height[v] = shared_height[v].load();
+        }
+        shared_cap = std::vector<std::atomic<T>>();
+        shared_excess = std::vector<std::atomic<T>>();
+        shared_height = std::vector<std::atomic<size_t>>();
+        active = std::vector<std::atomic<bool>>();
+        this->preflow_done = true;
+        return this->excess[this->sink];
+    }
+    T max_flow()
+    {
+        max_preflow();
+        return base::max_flow();
+    }
+    T resolve()
+    {
+        return max_preflow();
+    }
+    flow_result<T> result()
+    {
+        return _flow_result(this->graph, this->sink, max_flow());
+    }
+};
+
+// Dinic's algorithm. Every round labels the vertices with their residual
+// distance from the source, then saturates a blocking flow of the level
+// graph with an iterative depth-first search that keeps a current arc per
+// vertex.
+template<typename T>
+class _dinic
+{
+protected:
+    residual_graph<T> graph;
+    size_t n;
+    size_t source;
+    size_t sink;
+    std::vector<size_t> level;
+    std::vector<size_t> current;
+    std::vector<size_t> path;
+    T value;
+    bool done;
+    // Stops as soon as the sink is labeled, the farther vertices are useless
+    bool _bfs()
+    {
+        std::fill(level.begin(), level.end(), ULONG_MAX);
+        std::vector<size_t>& queue = path;
+        queue.clear();
+        level[source] = 0;
+        queue.push_back(source);
+        for(size_t k = 0; k < queue.size() && level[sink] == ULONG_MAX; k++)
+        {
+            size_t v = queue[k];
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t u = graph.target(i);
+                if(level[u] == ULONG_MAX && graph.capacity(i) > T(0))
+                {
+                    level[u] = level[v] + 1;
+                    queue.push_back(u);
+                }
+            }
+        }
+        return level[sink] != ULONG_MAX;
+    }
+    // `path` holds the arcs from the source to `v`. Dead ends get their
+    // level cleared so that they are never entered again in this round.
+    void _blocking_flow()
+    {
+        for(size_t v = 0; v < n; v++)
+            current[v] = graph.begin(v);
+        path.clear();
+        size_t v = source;
+        while(true)
+        {
+            if(v == sink)
+            {
+                T quantity = graph.capacity(path[0]);
+                for(size_t a: path)
+                    quantity = std::min(quantity, graph.capacity(a));
+                size_t saturated = path.size();
+                for(size_t k = 0; k < path.size(); k++)
+                {
+                    graph.push(path[k], quantity);
+                    if(saturated == path.size() && graph.capacity(path[k]) == T(0))
+                        saturated = k;
+                }
+                value += quantity;
+                path.resize(saturated);
+                v = saturated ? graph.target(path.back()) : source;
+                continue;
+            }
+            size_t& i = current[v];
+            for(; i < graph.end(v); i++)
+            {
+                if(graph.capacity(i) > T(0) && level[graph.target(i)] == level[v] + 1)
+                    break;
+            }
+            if(i < graph.end(v))
+            {
+                path.push_back(i);
+                v = graph.target(i);
+                continue;
+            }
+            if(v == source)
+                return;
+            level[v] = ULONG_MAX;
+            v = graph.target(graph.reverse(path.back()));
+            path.pop_back();
+            current[v]++;
+        }
+    }
+public:
+    _dinic(size_t vertices, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t s, size_t t) : graph(vertices, edges), n(vertices), source(s), sink(t), level(vertices), current(vertices), value(T(0)), done(false)
+    {
+        assert(source < n && sink < n && source != sink);
+    }
+    // Augmenting paths never leave excess behind, so both are the same
+    T max_preflow()
+    {
+        return max_flow();
+    }
+    T max_flow()
+    {
+        if(!done)
+        {
+            while(_bfs())
+                _blocking_flow();
+            done = true;
+        }
+        return value;
+    }
+    flow_result<T> result()
+    {
+        return _flow_result(graph, sink, max_flow());
+    }
+    const residual_graph<T>& residual() const
+    {
+        return graph;
+    }
+};
+
+// Boykov-Kolmogorov. A tree S grows from the source along residual arcs and
+// a tree T grows towards the sink along residual arcs; when they touch, the
+// path through them is augmented, the vertices cut off by saturated arcs
+// become orphans and look for a new parent in their own tree before being
+// freed. Orphans check that a candidate parent still leads to the root
+// through the timestamp and distance marks of Kolmogorov's implementation.
+template<typename T>
+class _boykov_kolmogorov
+{
+protected:
+    static constexpr unsigned char free_vertex = 0;
+    static constexpr unsigned char source_tree = 1;
+    static constexpr unsigned char sink_tree = 2;
+    // Values of `parent` besides arc indices
+    static constexpr size_t root = ULONG_MAX;
+    static constexpr size_t orphan = ULONG_MAX - 1;
+    static constexpr size_t none = ULONG_MAX - 2;
+    residual_graph<T> graph;
+    size_t n;
+    size_t source;
+    size_t sink;
+    std::vector<unsigned char> tree;
+    // Arc from the vertex to its parent, whatever the tree
+    std::vector<size_t> parent;
+    std::vector<size_t> timestamp;
+    std::vector<size_t> distance;
+    std::vector<bool> active;
+    // Where the growth of each active vertex resumes, so that the source and
+    // the sink are not rescanned after every augmentation
+    std::vector<size_t> next_arc;
+    std::deque<size_t> active_queue;
+    std::deque<size_t> orphans;
+    size_t time;
+    T value;
+    bool done;
+    // A vertex activated again, or while still active, may have new free
+    // neighbours anywhere, so its scan starts over
+    void _activate(size_t v)
+    {
+        next_arc[v] = graph.begin(v);
+        if(!active[v])
+        {
+            active[v] = true;
+            active_queue.push_back(v);
+        }
+    }
+    // Residual capacity from the parent side to the child side of the arc
+    // `a`, which leaves a vertex of tree `t`
+    T _tree_capacity(size_t a, unsigned char t) const
+    {
+        return t == source_tree ? graph.capacity(graph.reverse(a)) : graph.capacity(a);
+    }
+    // Grows the trees from the active vertices until they touch, returning
+    // the arc from S to T that joins them, or none
+    size_t _grow()
+    {
+        while(!active_queue.empty())
+        {
+            size_t p = active_queue.front();
+            if(!active[p] || tree[p] == free_vertex)
+            {
+                active[p] = false;
+                active_queue.pop_front();
+                continue;
+            }
+            for(size_t& i = next_arc[p]; i < graph.end(p); i++)
+            {
+                size_t q = graph.target(i);
+                T residual = tree[p] == source_tree ? graph.capacity(i) : graph.capacity(graph.reverse(i));
+                if(residual == T(0))
+                    continue;
+                if(tree[q] == free_vertex)
+                {
+                    tree[q] = tree[p];
+                    parent[q] = graph.reverse(i);
+                    timestamp[q] = timestamp[p];
+                    distance[q] = distance[p] + 1;
+                    _activate(q);
+                }
+                else if(tree[q] != tree[p])
+                {
+                    return tree[p] == source_tree ? i : graph.reverse(i);
+                }
+                else if(timestamp[q] <= timestamp[p] && distance[q] > distance[p])
+                {
+                    // Keeps the trees shallow, as in Kolmogorov's code
+                    parent[q] = graph.reverse(i);
+                    timestamp[q] = timestamp[p];
+                    distance[q] = distance[p] + 1;
+                }
+            }
+            active[p] = false;
+            active_queue.pop_front();
+        }
+        return none;
+    }
+    void _augment(size_t middle)
+    {
+        T quantity = graph.capacity(middle);
+        for(size_t v = graph.target(graph.reverse(middle)); parent[v] != root; v = graph.target(parent[v]))
+            quantity = std::min(quantity, graph.capacity(graph.reverse(parent[v])));
+        for(size_t v = graph.target(middle); parent[v] != root; v = graph.target(parent[v]))
+            quantity = std::min(quantity, graph.capacity(parent[v]));
+        graph.push(middle, quantity);
+        for(size_t v = graph.target(graph.reverse(middle)); parent[v] != root;)
+        {
+            size_t next = graph.target(parent[v]);
+            graph.push(graph.reverse(parent[v]), quantity);
+            if(graph.capacity(graph.reverse(parent[v])) == T(0))
+            {
+                parent[v] = orphan;
+                orphans.push_back(v);
+            }
+            v = next;
+        }
+        for(size_t v = graph.target(middle); parent[v] != root;)
+        {
+            size_t next = graph.target(parent[v]);
+            graph.push(parent[v], quantity);
+            if(graph.capacity(parent[v]) == T(0))
+            {
+                parent[v] = orphan;
+                orphans.push_back(v);
+            }
+            v = next;
+        }
+        value += quantity;
+    }
+    // Distance from `v` to its root, or none if the way up meets an orphan.
+    // Marks the vertices on the way with the current time.
+    size_t _origin(size_t v)
+    {
+        size_t d = 0;
+        size_t u = v;
+        while(timestamp[u] != time)
+        {
+            if(parent[u] == orphan)
+                return none;
+            if(parent[u] == root)
+            {
+                timestamp[u] = time;
+                distance[u] = 0;
+                break;
+            }
+            u = graph.target(parent[u]);
+            d++;
+        }
+        d += distance[u];
+        for(u = v; timestamp[u] != time; u = graph.target(parent[u]))
+        {
+            timestamp[u] = time;
+            distance[u] = d--;
+        }
+        return distance[v];
+    }
+    void _adopt()
+    {
+        while(!orphans.empty())
+        {
+            size_t v = orphans.front();
+            orphans.pop_front();
+            unsigned char t = tree[v];
+            size_t best = none;
+            size_t best_distance = ULONG_MAX;
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t q = graph.target(i);
+                if(tree[q] != t || _tree_capacity(i, t) == T(0))
+                    continue;
+                size_t d = _origin(q);
+                if(d != none && d < best_distance)
+                {
+                    best = i;
+                    best_distance = d;
+                }
+            }
+            if(best != none)
+            {
+                parent[v] = best;
+                timestamp[v] = time;
+                distance[v] = best_distance + 1;
+                continue;
+            }
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t q = graph.target(i);
+                if(tree[q] != t)
+                    continue;
+                if(_tree_capacity(i, t) > T(0))
+                    _activate(q);
+                if(parent[q] < none && graph.target(parent[q]) == v)
+                {
+                    parent[q] = orphan;
+                    orphans.push_back(q);
+                }
+            }
+            tree[v] = free_vertex;
+            active[v] = false;
+        }
+    }
+public:
+    _boykov_kolmogorov(size_t vertices, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t s, size_t t) : graph(vertices, edges), n(vertices), source(s), sink(t), tree(vertices, free_vertex), parent(vertices, none), timestamp(vertices, 0), distance(vertices, 0), active(vertices, false), next_arc(vertices), time(0), value(T(0)), done(false)
+    {
+        assert(source < n && sink < n && source != sink);
+    }
+    // Augmenting paths never leave excess behind, so both are the same
+    T max_preflow()
+    {
+        return max_flow();
+    }
+    T max_flow()
+    {
+        if(done)
+            return value;
+        tree[source] = source_tree;
+        tree[sink] = sink_tree;
+        parent[source] = root;
+        parent[sink] = root;
+        _activate(source);
+        _activate(sink);
+        while(true)
+        {
+            size_t middle = _grow();
+            if(middle == none)
+                break;
+            time++;
+            _augment(middle);
+            _adopt();
+        }
+        done = true;
+        return value;
+    }
+    flow_result<T> result()
+    {
+        return _flow_result(graph, sink, max_flow());
+    }
+    const residual_graph<T>& residual() const
+    {
+        return graph;
+    }
+};
+
+// Solver behind flow() for the algorithm `U`
+template<typename T, typename U>
+class _flow_solver
+{
+public:
+    typedef push_relabel<T, U> type;
+};
+
+template<typename T>
+class _flow_solver<T, policy::dinic>
+{
+public:
+    typedef _dinic<T> type;
+};
+
+template<typename T>
+class _flow_solver<T, policy::boykov_kolmogorov>
+{
+public:
+    typedef _boykov_kolmogorov<T> type;
+};
+
+// Maximum flow value from `source` to `sink`. With push-relabel only the
+// first phase runs, since the flow itself is not returned.
+template<typename T, typename U = policy::max_label>
+static T flow(size_t n, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t source, size_t sink)
+{
+    return typename _flow_solver<T, U>::type(n, edges, source, sink).max_preflow();
+}
+
+// Maximum flow from `source` to `sink` together with the flow on every edge
+// and a minimum cut, all from a single run of the solver
+template<typename T, typename U = policy::max_label>
+static flow_result<T> flow_and_cut(size_t n, const std::vector<std::tuple<size_t, size_t, T>>& edges, size_t source, size_t sink)
+{
+    return typename _flow_solver<T, U>::type(n, edges, source, sink).result();
+}
+
+// Everything a minimum cost flow computation finds out
+template<typename T, typename C>
+class min_cost_flow_result
+{
+public:
+    T value;
+    C cost;
+    // Flow on every input edge, in input order
+    std::vector<T> edge_flow;
+};
+
+// Successive shortest paths with vertex potentials. The reduced cost
+// c(u, v) + p(u) - p(v) of every residual arc stays non-negative, so each
+// round runs Dijkstra on it, with the priority queue `U` of shortest_paths(),
+// and stops once the sink is settled. Moving the potentials of the settled
+// vertices by their distance makes every shortest path cost zero, and
+// blocking flows, as in _dinic, then saturate the arcs of zero reduced cost
+// before the next round. Costs may be negative if no cycle is; they should
+// be integers, since arcs are admissible when their reduced cost is exactly
+// zero.
+template<typename T, typename C, typename U>
+class _successive_shortest_paths
+{
+protected:
+    residual_graph<T> graph;
+    // Cost of every arc, the opposite for reverse arcs
+    std::vector<C> cost;
+    size_t n;
+    size_t source;
+    size_t sink;
+    std::vector<C> potential;
+    std::vector<C> dist;
+    std::vector<bool> settled;
+    std::vector<size_t> level;
+    std::vector<size_t> current;
+    std::vector<size_t> path;
+    T value;
+    // Whether the sink cannot be reached anymore
+    bool done;
+    C _reduced_cost(size_t v, size_t arc) const
+    {
+        return cost[arc] + potential[v] - potential[graph.target(arc)];
+    }
+    // Initial potentials for negative costs: the distances from the source,
+    // by a queue-based Bellman-Ford. The vertices it cannot reach are never
+    // reached later either, so their potential does not matter.
+    void _bellman_ford()
+    {
+        const C inf = std::numeric_limits<C>::max();
+        std::fill(dist.begin(), dist.end(), inf);
+        std::vector<bool> queued(n, false);
+        std::queue<size_t> queue;
+        dist[source] = C(0);
+        queue.push(source);
+        while(!queue.empty())
+        {
+            size_t v = queue.front();
+            queue.pop();
+            queued[v] = false;
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t u = graph.target(i);
+                if(graph.capacity(i) > T(0) && dist[v] + cost[i] < dist[u])
+                {
+                    dist[u] = dist[v] + cost[i];
+                    if(!queued[u])
+                    {
+                        queued[u] = true;
+                        queue.push(u);
+                    }
+                }
+            }
+        }
+        for(size_t v = 0; v < n; v++)
+            potential[v] = dist[v] == inf ? C(0) : dist[v];
+    }
+    // The vertices left unsettled are at least as far as the sink, so
+    // moving only the settled ones, by dist - dist[sink], keeps the reduced
+    // costs non-negative
+    bool _dijkstra()
+    {
+        const C inf = std::numeric_limits<C>::max();
+        std::fill(dist.begin(), dist.end(), inf);
+        std::fill(settled.begin(), settled.end(), false);
+        std::vector<size_t>& order = path;
+        order.clear();
+        _sp_queue<C, U> q(n);
+        dist[source] = C(0);
+        q.update(source, C(0));
+        while(!q.empty())
+        {
+            size_t v = q.next();
+            if(settled[v])
+                continue;
+            settled[v] = true;
+            order.push_back(v);
+            if(v == sink)
+                break;
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t u = graph.target(i);
+                if(settled[u] || graph.capacity(i) == T(0))
+                    continue;
+                C d = dist[v] + _reduced_cost(v, i);
+                if(d < dist[u])
+                {
+                    dist[u] = d;
+                    q.update(u, d);
+                }
+            }
+        }
+        if(!settled[sink])
+            return false;
+        for(size_t v: order)
+            potential[v] += dist[v] - dist[sink];
+        return true;
+    }
+    // Levels over the admissible arcs, those with zero reduced cost
+    bool _bfs()
+    {
+        std::fill(level.begin(), level.end(), ULONG_MAX);
+        std::vector<size_t>& queue = path;
+        queue.clear();
+        level[source] = 0;
+        queue.push_back(source);
+        for(size_t k = 0; k < queue.size() && level[sink] == ULONG_MAX; k++)
+        {
+            size_t v = queue[k];
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                size_t u = graph.target(i);
+                if(level[u] == ULONG_MAX && graph.capacity(i) > T(0) && _reduced_cost(v, i) == C(0))
+                {
+                    level[u] = level[v] + 1;
+                    queue.push_back(u);
+                }
+            }
+        }
+        return level[sink] != ULONG_MAX;
+    }
+    // _dinic::_blocking_flow on the admissible arcs, sending at most `limit`
+    void _blocking_flow(T limit)
+    {
+        for(size_t v = 0; v < n; v++)
+            current[v] = graph.begin(v);
+        path.clear();
+        size_t v = source;
+        while(value < limit)
+        {
+            if(v == sink)
+            {
+                T quantity = limit - value;
+                for(size_t a: path)
+                    quantity = std::min(quantity, graph.capacity(a));
+                size_t saturated = path.size();
+                for(size_t k = 0; k < path.size(); k++)
+                {
+                    graph.push(path[k], quantity);
+                    if(saturated == path.size() && graph.capacity(path[k]) == T(0))
+                        saturated = k;
+                }
+                value += quantity;
+                path.resize(saturated);
+                v = saturated ? graph.target(path.back()) : source;
+                continue;
+            }
+            size_t& i = current[v];
+            for(; i < graph.end(v); i++)
+            {
+                if(graph.capacity(i) > T(0) && level[graph.target(i)] == level[v] + 1 && _reduced_cost(v, i) == C(0))
+                    break;
+            }
+            if(i < graph.end(v))
+            {
+                path.push_back(i);
+                v = graph.target(i);
+                continue;
+            }
+            if(v == source)
+                return;
+            level[v] = ULONG_MAX;
+            v = graph.target(graph.reverse(path.back()));
+            path.pop_back();
+            current[v]++;
+        }
+    }
+public:
+    _successive_shortest_paths(size_t vertices, const std::vector<std::tuple<size_t, size_t, T, C>>& edges, size_t s, size_t t) : graph(vertices, edges), cost(2 * edges.size()), n(vertices), source(s), sink(t), potential(vertices, C(0)), dist(vertices), settled(vertices), level(vertices), current(vertices), value(T(0)), done(false)
+    {
+        assert(source < n && sink < n && source != sink);
+        bool negative = false;
+        for(size_t i = 0; i < edges.size(); i++)
+        {
+            size_t forward = graph.arc(i);
+            cost[forward] = std::get<3>(edges[i]);
+            cost[graph.reverse(forward)] = -std::get<3>(edges[i]);
+            if(std::get<3>(edges[i]) < C(0) && std::get<2>(edges[i]) > T(0))
+                negative = true;
+        }
+        if(negative)
+            _bellman_ford();
+    }
+    // Sends flow until `limit` units have gone through or the sink cannot
+    // be reached, and returns the total; a later call with a larger limit
+    // carries on from there
+    T max_flow(T limit = std::numeric_limits<T>::max())
+    {
+        while(!done && value < limit)
+        {
+            if(!_dijkstra())
+            {
+                done = true;
+                break;
+            }
+            while(value < limit && _bfs())
+                _blocking_flow(limit);
+        }
+        return value;
+    }
+    // Cost of the flow sent so far
+    C cost_of_flow() const
+    {
+        C total = C(0);
+        for(size_t i = 0; i < graph.edges(); i++)
+        {
+            size_t forward = graph.arc(i);
+            total += C(graph.capacity(graph.reverse(forward))) * cost[forward];
+        }
+        return total;
+    }
+    min_cost_flow_result<T, C> result(T limit = std::numeric_limits<T>::max())
+    {
+        min_cost_flow_result<T, C> r;
+        r.value = max_flow(limit);
+        r.cost = cost_of_flow();
+        r.edge_flow.resize(graph.edges());
+        for(size_t i = 0; i < graph.edges(); i++)
+            r.edge_flow[i] = graph.capacity(graph.reverse(graph.arc(i)));
+        return r;
+    }
+    const residual_graph<T>& residual() const
+    {
+        return graph;
+    }
+};
+
+// Integer types for the scaled costs and prices of _cost_scaling, which grow
+// to about 8V² times the largest cost: long long when that fits, otherwise
+// `wide`, a 128-bit integer where the compiler has one
+class _scaled_cost
+{
+public:
+#ifdef __SIZEOF_INT128__
+    __extension__ typedef __int128 wide;
+    __extension__ typedef unsigned __int128 uwide;
+    static constexpr wide wide_max = wide(~uwide(0) >> 1);
+#else
+    typedef long long wide;
+    static constexpr wide wide_max = LLONG_MAX;
+#endif
+    template<typename S>
+    static constexpr wide max()
+    {
+        return std::is_same<S, long long>::value ? wide(LLONG_MAX) : wide_max;
+    }
+    // Whether S holds the scaled costs and prices for costs up to `largest`
+    // in absolute value on `n` vertices
+    template<typename S>
+    static bool fits(wide largest, size_t n)
+    {
+        return largest <= max<S>() / wide(8) / wide(n + 2) / wide(n + 2);
+    }
+    template<typename T, typename C>
+    static wide largest(const std::vector<std::tuple<size_t, size_t, T, C>>& edges)
+    {
+        wide r = 0;
+        for(const auto& i: edges)
+            r = std::max(r, std::get<3>(i) < C(0) ? -wide(std::get<3>(i)) : wide(std::get<3>(i)));
+        return r;
+    }
+};
+
+// Goldberg's cost scaling. push_relabel first finds a maximum flow, of at
+// most `limit` units through an extra vertex in front of the source, then
+// the prices are refined: costs are multiplied by the number of vertices
+// plus one, and every round divides ε by `alpha`, saturates the arcs of
+// negative reduced cost and discharges the excess in FIFO order along the
+// admissible arcs, lowering the price of a vertex just enough to make one of
+// its arcs admissible. Once ε = 1 no negative cycle is left, so negative
+// cycles in the input are fine too: they end up saturated. Costs must be
+// integers.
+template<typename T, typename C, typename S>
+class _cost_scaling
+{
+protected:
+    static_assert(std::is_integral<C>::value, "cost scaling needs integral costs");
+    static constexpr S alpha = 8;
+    residual_graph<T> graph;
+    // Cost of every arc, scaled, the opposite for reverse arcs
+    std::vector<S> cost;
+    // Vertices, the extra one included
+    size_t n;
+    std::vector<S> price;
+    std::vector<T> excess;
+    std::vector<size_t> current;
+    std::queue<size_t> active;
+    static residual_graph<T> _feasible_flow(size_t n, const std::vector<std::tuple<size_t, size_t, T, C>>& edges, size_t source, size_t sink, T limit)
+    {
+        std::vector<std::tuple<size_t, size_t, T>> e;
+        e.reserve(edges.size() + 1);
+        // Capacity out of the source, saturating at `limit`
+        T out = T(0);
+        for(const auto& i: edges)
+        {
+            e.emplace_back(std::get<0>(i), std::get<1>(i), std::get<2>(i));
+            if(std::get<0>(i) == source)
+                out = limit - out <= std::get<2>(i) ? limit : out + std::get<2>(i);
+        }
+        e.emplace_back(n, source, out);
+        push_relabel<T> p(n + 1, e, n, sink);
+        p.max_flow();
+        return p.residual();
+    }
+    S _reduced_cost(size_t v, size_t arc) const
+    {
+        return cost[arc] + price[v] - price[graph.target(arc)];
+    }
+    void _push(size_t v, size_t arc, T quantity)
+    {
+        size_t w = graph.target(arc);
+        graph.push(arc, quantity);
+        excess[v] -= quantity;
+        if(excess[w] <= T(0) && excess[w] + quantity > T(0))
+            active.push(w);
+        excess[w] += quantity;
+    }
+    // Some residual arc always leaves a vertex with excess, since the
+    // excess came along one
+    void _relabel(size_t v, S epsilon)
+    {
+        bool found = false;
+        S best = S(0);
+        for(size_t i = graph.begin(v); i < graph.end(v); i++)
+        {
+            if(graph.capacity(i) > T(0) && (!found || price[graph.target(i)] - cost[i] > best))
+            {
+                best = price[graph.target(i)] - cost[i];
+                found = true;
+            }
+        }
+        assert(found);
+        price[v] = best - epsilon;
+        current[v] = graph.begin(v);
+    }
+    void _discharge(size_t v, S epsilon)
+    {
+        while(excess[v] > T(0))
+        {
+            size_t& i = current[v];
+            for(; i < graph.end(v); i++)
+            {
+                if(graph.capacity(i) > T(0) && _reduced_cost(v, i) < S(0))
+                    break;
+            }
+            if(i < graph.end(v))
+                _push(v, i, std::min(excess[v], graph.capacity(i)));
+            else
+                _relabel(v, epsilon);
+        }
+    }
+    // Turns an (alpha * epsilon)-optimal flow into an epsilon-optimal one
+    void _refine(S epsilon)
+    {
+        for(size_t v = 0; v < n; v++)
+        {
+            current[v] = graph.begin(v);
+            for(size_t i = graph.begin(v); i < graph.end(v); i++)
+            {
+                if(graph.capacity(i) > T(0) && _reduced_cost(v, i) < S(0))
+                    _push(v, i, graph.capacity(i));
+            }
+        }
+        while(!active.empty())
+        {
+            size_t v = active.front();
+            active.pop();
+            _discharge(v, epsilon);
+        }
+    }
+public:
+    _cost_scaling(size_t vertices, const std::vector<std::tuple<size_t, size_t, T, C>>& edges, size_t s, size_t t, T limit) : graph(_feasible_flow(vertices, edges, s, t, limit)), cost(2 * edges.size() + 2, S(0)), n(vertices + 1), price(vertices + 1, S(0)), excess(vertices + 1, T(0)), current(vertices + 1)
+    {
+        assert(s < vertices && t < vertices && s != t);
+        assert(_scaled_cost::fits<S>(_scaled_cost::largest(edges), vertices));
+        S epsilon = S(0);
+        for(size_t i = 0; i < edges.size(); i++)
+        {
+            size_t forward = graph.arc(i);
+            S c = S(std::get<3>(edges[i]));
+            cost[forward] = c * S(n + 1);
+            cost[graph.reverse(forward)] = -cost[forward];
+            epsilon = std::max(epsilon, std::max(cost[forward], -cost[forward]));
+        }
+        while(epsilon > S(1))
+        {
+            epsilon = std::max(epsilon / alpha, S(1));
+            _refine(epsilon);
+        }
+    }
+    min_cost_flow_result<T, C> result() const
+    {
+        min_cost_flow_result<T, C> r;
+        size_t m = graph.edges() - 1;
+        r.value = graph.capacity(graph.reverse(graph.arc(m)));
+        r.cost = C(0);
+        r.edge_flow.resize(m);
+        for(size_t i = 0; i < m; i++)
+        {
+            size_t forward = graph.arc(i);
+            r.edge_flow[i] = graph.capacity(graph.reverse(forward));
+            r.cost += C(r.edge_flow[i]) * C(cost[forward] / S(n + 1));
+        }
+        return r;
+    }
+    const residual_graph<T>& residual() const
+    {
+        return graph;
+    }
+};
+
+// Solver behind min_cost_flow() for the algorithm `U`
+template<typename T, typename C, typename U>
+class _min_cost_flow_solver
+{
+public:
+    static min_cost_flow_result<T, C> solve(size_t n, const std::vector<std::tuple<size_t, size_t, T, C>>& edges, size_t source, size_t sink, T limit)
+    {
+        return _successive_shortest_paths<T, C, U>(n, edges, source, sink).result(limit);
+    }
+};
+
+template<typename T, typename C>
+class _min_cost_flow_solver<T, C, policy::cost_scaling>
+{
+public:
+    static min_cost_flow_result<T, C> solve(size_t n, const std::vector<std::tuple<size_t, size_t, T, C>>& edges, size_t source, size_t sink, T limit)
+    {
+        if(_scaled_cost::fits<long long>(_scaled_cost::largest(edges), n))
+            return _cost_scaling<T, C, long long>(n, edges, source, sink, limit).result();
+        return _cost_scaling<T, C, _scaled_cost::wide>(n, edges, source, sink, limit).result();
+    }
+};
+
+// Maximum flow from `source` to `sink`, or `limit` units if less, of
+// minimum total cost, together with the flow on every edge. The edges are
+// (from, to, capacity, cost). policy::cost_scaling needs integral costs; it
+// works on them scaled by about V, in long long or, if the largest cost
+// leaves too little headroom for that, in a 128-bit integer.
+template<typename T, typename C, typename U = policy::cost_scaling>
+static min_cost_flow_result<T, C> min_cost_flow(size_t n, const std::vector<std::tuple<size_t, size_t, T, C>>& edges, size_t source, size_t sink, T limit = std::numeric_limits<T>::max())
+{
+    return _min_cost_flow_solver<T, C, U>::solve(n, edges, source, sink, limit);
 }
 
 }
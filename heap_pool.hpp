@@ -0,0 +1,165 @@
+/****************************************************
+*                                                   *
+* License: Apache License 2.0                       *
+* Author: Dario Ostuni <another.code.996@gmail.com> *
+*                                                   *
+****************************************************/
+
+#pragma once
+
+// Internal support for binomial_heap.hpp and pairing_heap.hpp
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ostuni
+{
+// Holds the comparator of a heap, taking no space when it is stateless
+template <typename Compare, bool = std::is_empty<Compare>::value && !std::is_final<Compare>::value>
+class _heap_compare : protected Compare
+{
+protected:
+    _heap_compare(const Compare& c) : Compare(c)
+    {
+    }
+    const Compare& comp() const
+    {
+        return *this;
+    }
+    void swap(_heap_compare& o)
+    {
+        using std::swap;
+        swap(static_cast<Compare&>(*this), static_cast<Compare&>(o));
+    }
+};
+
+template <typename Compare>
+class _heap_compare<Compare, false>
+{
+protected:
+    Compare c;
+    _heap_compare(const Compare& _c) : c(_c)
+    {
+    }
+    const Compare& comp() const
+    {
+        return c;
+    }
+    void swap(_heap_compare& o)
+    {
+        using std::swap;
+        swap(c, o.c);
+    }
+};
+
+// Nodes are carved out of slabs obtained from the allocator and recycled
+// through an intrusive free list, so a push costs no allocation once the heap
+// has warmed up. The slabs are released with the pool, without destroying the
+// nodes still in use: that is up to the owner.
+template <typename Node, typename Allocator>
+class _heap_pool
+{
+protected:
+    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> allocator_type;
+    typedef std::allocator_traits<allocator_type> traits;
+    static constexpr size_t min_slab_size = 32;
+    static constexpr size_t max_slab_size = 1 << 16;
+    allocator_type alloc;
+    std::vector<std::pair<Node*, size_t>> slabs;
+    Node* free_list;
+    size_t free_count;
+    static Node*& next_free(Node* e)
+    {
+        return *std::launder(reinterpret_cast<Node**>(e));
+    }
+    void push_free(Node* e)
+    {
+        ::new(static_cast<void*>(e)) Node*(free_list);
+        free_list = e;
+        free_count++;
+    }
+    void grow(size_t slab_size)
+    {
+        Node* slab = traits::allocate(alloc, slab_size);
+        slabs.emplace_back(slab, slab_size);
+        for(size_t i = slab_size; i > 0; i--)
+            push_free(slab + i - 1);
+    }
+
+public:
+    _heap_pool(const Allocator& a = Allocator()) : alloc(a)
+    {
+        free_list = nullptr;
+        free_count = 0;
+    }
+    _heap_pool(const _heap_pool&) = delete;
+    _heap_pool& operator=(const _heap_pool&) = delete;
+    ~_heap_pool()
+    {
+        for(const auto& s: slabs)
+            traits::deallocate(alloc, s.first, s.second);
+    }
+    template <typename... Args>
+    Node* create(Args&&... args)
+    {
+        if(!free_list)
+            grow(slabs.empty() ? min_slab_size : std::min(slabs.back().second * 2, max_slab_size));
+        Node* e = free_list;
+        free_list = next_free(e);
+        free_count--;
+        try
+        {
+            traits::construct(alloc, e, std::forward<Args>(args)...);
+        }
+        catch(...)
+        {
+            push_free(e);
+            throw;
+        }
+        return e;
+    }
+    void destroy(Node* e)
+    {
+        traits::destroy(alloc, e);
+        push_free(e);
+    }
+    // Makes room for `n` more nodes with at most one allocation
+    void reserve(size_t n)
+    {
+        if(free_count < n)
+            grow(std::max(n - free_count, min_slab_size));
+    }
+    // Takes ownership of all the slabs of `o`, leaving it empty. The
+    // allocators must compare equal.
+    void splice(_heap_pool& o)
+    {
+        assert(alloc == o.alloc);
+        slabs.insert(slabs.end(), o.slabs.begin(), o.slabs.end());
+        o.slabs.clear();
+        while(o.free_list)
+        {
+            Node* e = o.free_list;
+            o.free_list = next_free(e);
+            push_free(e);
+        }
+        o.free_count = 0;
+    }
+    void swap(_heap_pool& o)
+    {
+        using std::swap;
+        swap(alloc, o.alloc);
+        swap(slabs, o.slabs);
+        swap(free_list, o.free_list);
+        swap(free_count, o.free_count);
+    }
+    Allocator get_allocator() const
+    {
+        return Allocator(alloc);
+    }
+};
+}
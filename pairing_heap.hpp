@@ -8,53 +8,121 @@
 #pragma once
 
 #include <cassert>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "heap_pool.hpp"
 
 namespace ostuni {
 
-template <typename T>
+namespace policy {
+
+// How pairing_heap combines the children of a removed root
+
+// Pairs them left to right, then merges the pairs right to left
+class two_pass {};
+
+// Keeps merging the first two trees and appending the result to the end,
+// until a single tree is left
+class multipass {};
+
+} // namespace policy
+
+template <typename T, typename Compare, typename Pairing, typename Allocator>
+class pairing_heap_container;
+
+// Min-heap with respect to Compare. The comparator is not stored in the nodes:
+// every operation that compares values takes it as a trailing argument.
+template <typename T, typename Compare = std::less<T>, typename Pairing = policy::two_pass>
 class pairing_heap {
   protected:
     T value;
-    pairing_heap<T>* next;
-    pairing_heap<T>* prev;
-    pairing_heap<T>* child;
+    pairing_heap* next;
+    pairing_heap* prev;
+    pairing_heap* child;
 
-    static pairing_heap<T>* merge_pairs(pairing_heap<T>* a) {
+    // Both variants are iterative, so any number of children is fine
+    static pairing_heap* merge_pairs(pairing_heap* a, const Compare& comp, policy::two_pass) {
+        // The merged pairs are stacked through `next`, last one on top
+        pairing_heap* pairs = nullptr;
+        while(a) {
+            pairing_heap* b = a->next;
+            pairing_heap* other = b ? b->next : nullptr;
+            a->next = a->prev = nullptr;
+            if(b) {
+                b->next = b->prev = nullptr;
+                a = merge(a, b, comp);
+            }
+            a->next = pairs;
+            pairs = a;
+            a = other;
+        }
+        pairing_heap* result = nullptr;
+        while(pairs) {
+            pairing_heap* other = pairs->next;
+            pairs->next = nullptr;
+            result = merge(pairs, result, comp);
+            pairs = other;
+        }
+        return result;
+    }
+
+    static pairing_heap* merge_pairs(pairing_heap* a, const Compare& comp, policy::multipass) {
         if(!a)
             return nullptr;
-        if(!a->next)
-            return a;
-        pairing_heap<T>* other = a->next->next;
-        pairing_heap<T>* b = a->next;
-        a->next = b->next = nullptr;
-        b->prev = nullptr;
-        if(other)
-            other->prev = nullptr;
-        return merge(merge(a, b), merge_pairs(other));
+        pairing_heap* tail = a;
+        while(tail->next)
+            tail = tail->next;
+        while(a->next) {
+            pairing_heap* b = a->next;
+            pairing_heap* other = b->next;
+            a->next = a->prev = nullptr;
+            b->next = b->prev = nullptr;
+            a = merge(a, b, comp);
+            if(!other)
+                break;
+            tail->next = a;
+            tail = a;
+            a = other;
+        }
+        a->prev = nullptr;
+        return a;
     }
 
+    static pairing_heap* merge_pairs(pairing_heap* a, const Compare& comp) { return merge_pairs(a, comp, Pairing()); }
+
   public:
-    pairing_heap(const T& _value = T(), pairing_heap<T>* _next = nullptr, pairing_heap<T>* _prev = nullptr,
-                 pairing_heap<T>* _child = nullptr) {
-        value = _value;
-        next = _next;
-        prev = _prev;
-        child = _child;
-    }
+    pairing_heap(const T& _value = T(), pairing_heap* _next = nullptr, pairing_heap* _prev = nullptr,
+                 pairing_heap* _child = nullptr)
+        : value(_value), next(_next), prev(_prev), child(_child) {}
+
+    pairing_heap(T&& _value, pairing_heap* _next = nullptr, pairing_heap* _prev = nullptr,
+                 pairing_heap* _child = nullptr)
+        : value(std::move(_value)), next(_next), prev(_prev), child(_child) {}
 
-    static const T& top(const pairing_heap<T>* a) {
+    template <typename... Args>
+    pairing_heap(std::in_place_t, Args&&... args)
+        : value(std::forward<Args>(args)...), next(nullptr), prev(nullptr), child(nullptr) {}
+
+    static const T& top(const pairing_heap* a) {
         assert(a);
         return a->value;
     }
 
-    static pairing_heap<T>* merge(pairing_heap<T>* a, pairing_heap<T>* b) {
+    static pairing_heap* merge(pairing_heap* a, pairing_heap* b, const Compare& comp = Compare()) {
         if(!a)
             return b;
         if(!b)
             return a;
-        pairing_heap<T>* upper = b;
-        pairing_heap<T>* lower = a;
-        if(top(a) < top(b)) {
+        pairing_heap* upper = b;
+        pairing_heap* lower = a;
+        if(comp(top(a), top(b))) {
             upper = a;
             lower = b;
         }
@@ -68,37 +136,52 @@ class pairing_heap {
         return upper;
     }
 
-    static pairing_heap<T>* insert(pairing_heap<T>* a, const T& v) { return merge(a, new pairing_heap<T>(v)); }
+    static pairing_heap* insert(pairing_heap* a, const T& v, const Compare& comp = Compare()) {
+        return merge(a, new pairing_heap(v), comp);
+    }
 
-    static pairing_heap<T>* remove_top(pairing_heap<T>* a) {
+    static pairing_heap* insert(pairing_heap* a, T&& v, const Compare& comp = Compare()) {
+        return merge(a, new pairing_heap(std::move(v)), comp);
+    }
+
+    static pairing_heap* remove_top(pairing_heap* a, const Compare& comp = Compare()) {
         if(!a)
             return nullptr;
-        pairing_heap<T>* child = a->child;
+        pairing_heap* child = a->child;
         if(child)
             child->prev = nullptr;
         delete a;
-        return merge_pairs(child);
+        return merge_pairs(child, comp);
     }
 
-    static pairing_heap<T>* remove_top_nodelete(pairing_heap<T>* a) {
+    // Moves the top value out, removes its node and updates `a` to the new root
+    static T extract_top(pairing_heap*& a, const Compare& comp = Compare()) {
+        assert(a);
+        T v = std::move(a->value);
+        a = remove_top(a, comp);
+        return v;
+    }
+
+    static pairing_heap* remove_top_nodelete(pairing_heap* a, const Compare& comp = Compare()) {
         if(!a)
             return nullptr;
-        pairing_heap<T>* child = a->child;
+        pairing_heap* child = a->child;
         if(child)
             child->prev = nullptr;
         a->next = a->prev = a->child = nullptr;
-        return merge_pairs(child);
+        return merge_pairs(child, comp);
     }
 
-    static pairing_heap<T>* decrease_key(pairing_heap<T>* root, pairing_heap<T>* node, const T& new_value) {
-        assert(!(top(node) < new_value));
-        node->value = new_value;
+    static pairing_heap* decrease_key(pairing_heap* root, pairing_heap* node, T new_value,
+                                      const Compare& comp = Compare()) {
+        assert(!comp(top(node), new_value));
+        node->value = std::move(new_value);
         if(!node->prev) {
             assert(node == root);
             return node;
         }
         if(node->prev->child == node) {
-            if(!(top(node) < top(node->prev)))
+            if(!comp(top(node), top(node->prev)))
                 return root;
             node->prev->child = node->next;
         } else {
@@ -108,8 +191,315 @@ class pairing_heap {
             node->next->prev = node->prev;
         node->prev = nullptr;
         node->next = nullptr;
-        return merge(node, root);
+        return merge(node, root, comp);
+    }
+
+    template <typename, typename, typename, typename>
+    friend class pairing_heap_container;
+};
+
+// Owning pairing heap. Nodes are carved out of slabs obtained from Allocator
+// and recycled through a free list, and the whole tree is released when the
+// container goes away. The nodes returned by push() can be used as handles
+// for decrease_key() until they are popped.
+template <typename T, typename Compare = std::less<T>, typename Pairing = policy::two_pass,
+          typename Allocator = std::allocator<T>>
+class pairing_heap_container : protected _heap_compare<Compare> {
+  public:
+    typedef pairing_heap<T, Compare, Pairing> node_type;
+
+  protected:
+    typedef _heap_compare<Compare> compare_base;
+    using compare_base::comp;
+
+    _heap_pool<node_type, Allocator> pool;
+    node_type* root;
+    size_t node_count;
+
+    // Unlinks the first child of the node on top of the list and puts it in
+    // front, so every node is visited once without recursion
+    void destroy_tree(node_type* a) {
+        while(a) {
+            if(a->child) {
+                node_type* c = a->child;
+                a->child = c->next;
+                c->next = a;
+                a = c;
+            } else {
+                node_type* other = a->next;
+                pool.destroy(a);
+                a = other;
+            }
+        }
+    }
+
+  public:
+    pairing_heap_container(const Compare& c = Compare(), const Allocator& a = Allocator())
+        : compare_base(c), pool(a), root(nullptr), node_count(0) {}
+
+    pairing_heap_container(const pairing_heap_container&) = delete;
+    pairing_heap_container& operator=(const pairing_heap_container&) = delete;
+
+    pairing_heap_container(pairing_heap_container&& o) : pairing_heap_container(o.comp(), o.get_allocator()) {
+        swap(o);
+    }
+
+    pairing_heap_container& operator=(pairing_heap_container&& o) {
+        pairing_heap_container tmp(std::move(o));
+        swap(tmp);
+        return *this;
+    }
+
+    ~pairing_heap_container() {
+        // The slabs are released by the pool, so trivially destructible
+        // values need no traversal at all
+        if(!std::is_trivially_destructible<T>::value)
+            clear();
+    }
+
+    bool empty() const { return !root; }
+
+    size_t size() const { return node_count; }
+
+    const T& top() const { return node_type::top(root); }
+
+    node_type* push(const T& v) { return emplace(v); }
+
+    node_type* push(T&& v) { return emplace(std::move(v)); }
+
+    template <typename... Args>
+    node_type* emplace(Args&&... args) {
+        node_type* a = pool.create(std::in_place, std::forward<Args>(args)...);
+        root = node_type::merge(root, a, comp());
+        node_count++;
+        return a;
+    }
+
+    // Returns the removed value, moved out of its node
+    T pop() {
+        assert(root);
+        node_type* a = root;
+        root = node_type::remove_top_nodelete(root, comp());
+        T v = std::move(a->value);
+        pool.destroy(a);
+        node_count--;
+        return v;
+    }
+
+    void decrease_key(node_type* a, T v) { root = node_type::decrease_key(root, a, std::move(v), comp()); }
+
+    // Takes all the nodes of `o`, which is left empty. The allocators must
+    // compare equal.
+    void merge(pairing_heap_container& o) {
+        if(&o == this)
+            return;
+        pool.splice(o.pool);
+        root = node_type::merge(root, o.root, comp());
+        node_count += o.node_count;
+        o.root = nullptr;
+        o.node_count = 0;
     }
+
+    void clear() {
+        destroy_tree(root);
+        root = nullptr;
+        node_count = 0;
+    }
+
+    void swap(pairing_heap_container& o) {
+        using std::swap;
+        compare_base::swap(o);
+        pool.swap(o.pool);
+        swap(root, o.root);
+        swap(node_count, o.node_count);
+    }
+
+    Compare value_comp() const { return comp(); }
+
+    Allocator get_allocator() const { return pool.get_allocator(); }
+};
+
+// Pairing heap whose nodes live in a single vector and are linked by 32-bit
+// indices. As in pairing_heap, `prev` is the parent for a first child and the
+// left sibling otherwise, so a node is the value plus three indices: half the
+// size of a pairing_heap node for 32-bit values on a 64-bit target. Handles
+// are indices and stay valid until popped; removed slots are reused.
+template <typename T, typename Compare = std::less<T>, typename Pairing = policy::two_pass>
+class compact_pairing_heap : protected _heap_compare<Compare> {
+  public:
+    typedef uint32_t handle_type;
+
+  protected:
+    typedef _heap_compare<Compare> compare_base;
+    using compare_base::comp;
+
+    static constexpr uint32_t none = std::numeric_limits<uint32_t>::max();
+
+    class node {
+      public:
+        T value;
+        uint32_t next;
+        uint32_t prev;
+        uint32_t child;
+        template <typename... Args>
+        node(Args&&... args) : value(std::forward<Args>(args)...), next(none), prev(none), child(none) {}
+    };
+
+    std::vector<node> nodes;
+    uint32_t root;
+    // Removed slots, linked through `next`
+    uint32_t free_list;
+    size_t node_count;
+
+    uint32_t merge(uint32_t a, uint32_t b) {
+        if(a == none)
+            return b;
+        if(b == none)
+            return a;
+        uint32_t upper = b;
+        uint32_t lower = a;
+        if(comp()(nodes[a].value, nodes[b].value)) {
+            upper = a;
+            lower = b;
+        }
+        assert(nodes[lower].next == none);
+        nodes[lower].next = nodes[upper].child;
+        nodes[lower].prev = upper;
+        if(nodes[upper].child != none)
+            nodes[nodes[upper].child].prev = lower;
+        nodes[upper].child = lower;
+        return upper;
+    }
+
+    uint32_t merge_pairs(uint32_t a, policy::two_pass) {
+        uint32_t pairs = none;
+        while(a != none) {
+            uint32_t b = nodes[a].next;
+            uint32_t other = b != none ? nodes[b].next : none;
+            nodes[a].next = nodes[a].prev = none;
+            if(b != none) {
+                nodes[b].next = nodes[b].prev = none;
+                a = merge(a, b);
+            }
+            nodes[a].next = pairs;
+            pairs = a;
+            a = other;
+        }
+        uint32_t result = none;
+        while(pairs != none) {
+            uint32_t other = nodes[pairs].next;
+            nodes[pairs].next = none;
+            result = merge(pairs, result);
+            pairs = other;
+        }
+        return result;
+    }
+
+    uint32_t merge_pairs(uint32_t a, policy::multipass) {
+        if(a == none)
+            return none;
+        uint32_t tail = a;
+        while(nodes[tail].next != none)
+            tail = nodes[tail].next;
+        while(nodes[a].next != none) {
+            uint32_t b = nodes[a].next;
+            uint32_t other = nodes[b].next;
+            nodes[a].next = nodes[a].prev = none;
+            nodes[b].next = nodes[b].prev = none;
+            a = merge(a, b);
+            if(other == none)
+                break;
+            nodes[tail].next = a;
+            tail = a;
+            a = other;
+        }
+        nodes[a].prev = none;
+        return a;
+    }
+
+  public:
+    compact_pairing_heap(const Compare& c = Compare()) : compare_base(c), root(none), free_list(none), node_count(0) {}
+
+    bool empty() const { return root == none; }
+
+    size_t size() const { return node_count; }
+
+    void reserve(size_t n) { nodes.reserve(n); }
+
+    const T& top() const {
+        assert(root != none);
+        return nodes[root].value;
+    }
+
+    const T& get(handle_type h) const { return nodes[h].value; }
+
+    handle_type push(const T& v) { return emplace(v); }
+
+    handle_type push(T&& v) { return emplace(std::move(v)); }
+
+    template <typename... Args>
+    handle_type emplace(Args&&... args) {
+        uint32_t a = free_list;
+        if(a != none) {
+            free_list = nodes[a].next;
+            nodes[a].value = T(std::forward<Args>(args)...);
+            nodes[a].next = none;
+        } else {
+            assert(nodes.size() < none);
+            a = nodes.size();
+            nodes.emplace_back(std::forward<Args>(args)...);
+        }
+        root = merge(root, a);
+        node_count++;
+        return a;
+    }
+
+    // Returns the removed value, moved out of its node
+    T pop() {
+        assert(root != none);
+        uint32_t a = root;
+        uint32_t child = nodes[a].child;
+        if(child != none)
+            nodes[child].prev = none;
+        root = merge_pairs(child, Pairing());
+        T v = std::move(nodes[a].value);
+        nodes[a].child = none;
+        nodes[a].next = free_list;
+        free_list = a;
+        node_count--;
+        return v;
+    }
+
+    void decrease_key(handle_type a, T v) {
+        assert(!comp()(nodes[a].value, v));
+        nodes[a].value = std::move(v);
+        uint32_t prev = nodes[a].prev;
+        if(prev == none) {
+            assert(a == root);
+            return;
+        }
+        if(nodes[prev].child == a) {
+            if(!comp()(nodes[a].value, nodes[prev].value))
+                return;
+            nodes[prev].child = nodes[a].next;
+        } else {
+            nodes[prev].next = nodes[a].next;
+        }
+        if(nodes[a].next != none)
+            nodes[nodes[a].next].prev = prev;
+        nodes[a].prev = none;
+        nodes[a].next = none;
+        root = merge(a, root);
+    }
+
+    void clear() {
+        nodes.clear();
+        root = none;
+        free_list = none;
+        node_count = 0;
+    }
+
+    Compare value_comp() const { return comp(); }
 };
 
 } // namespace ostuni
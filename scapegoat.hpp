@@ -8,14 +8,42 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <climits>
 #include <cmath>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
 #include <queue>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 namespace ostuni
 {
-template <typename T>
+namespace policy
+{
+// Where scapegoat puts its nodes in memory when the whole tree is rebuilt
+
+// Nodes stay where they were allocated
+class allocation_order
+{
+};
+
+// Nodes are moved to the front of the array in breadth-first order
+class bfs_order
+{
+};
+
+// Nodes are moved to the front of the array in van Emde Boas order: every
+// subtree of height 2^k is contiguous, whatever the cache line size
+class veb_order
+{
+};
+}
+
+template <typename T, typename Layout>
 class scapegoat;
 
 template <typename T>
@@ -35,16 +63,29 @@ protected:
         right_child = -1;
         parent = -1;
     }
+    void reset(T&& v)
+    {
+        tree_size = 1;
+        value = std::move(v);
+        left_child = -1;
+        right_child = -1;
+        parent = -1;
+    }
     _scapegoat_node(const T& v)
     {
         reset(v);
     }
+    _scapegoat_node(T&& v)
+    {
+        reset(std::move(v));
+    }
 
 public:
-    friend class scapegoat<T>;
+    template <typename, typename>
+    friend class scapegoat;
 };
 
-template <typename T>
+template <typename T, typename Layout = policy::allocation_order>
 class scapegoat
 {
 protected:
@@ -53,38 +94,38 @@ protected:
     std::queue<int> unused_nodes;
     int root_node;
     unsigned max_size;
-    int _find(const T& v, int node)
+    // min_size_for_depth[d] is the smallest tree size for which a leaf at
+    // depth d (the root being at depth 1) keeps the tree alpha-height-balanced;
+    // deeper leaves are never allowed
+    std::vector<unsigned> min_size_for_depth;
+    // Scratch space for rebuilds, kept to avoid reallocating every time
+    std::vector<int> rebuild_buffer;
+    std::vector<int> rebuild_stack;
+    std::vector<int> layout_order;
+    std::vector<int> layout_source;
+    int _find(const T& v, int node) const
     {
-        if(nodes[node].value == v)
-            return node;
-        if(v < nodes[node].value)
-        {
-            if(nodes[node].left_child == -1)
-                return -1;
-            return _find(v, nodes[node].left_child);
-        }
-        else
-        {
-            if(nodes[node].right_child == -1)
-                return -1;
-            return _find(v, nodes[node].right_child);
-        }
+        while(node != -1 && !(nodes[node].value == v))
+            node = v < nodes[node].value ? nodes[node].left_child : nodes[node].right_child;
+        return node;
     }
-    int _get_node_size(int node)
+    int _get_node_size(int node) const
     {
         if(node == -1)
             return 0;
         return nodes[node].tree_size;
     }
-    int _find_scapegoat(int node)
+    int _find_scapegoat(int node) const
     {
-        if(node == root_node)
-            return node;
-        bool e1 = _get_node_size(nodes[node].left_child) <= a * _get_node_size(node);
-        bool e2 = _get_node_size(nodes[node].right_child) <= a * _get_node_size(node);
-        if(!(e1 && e2))
-            return node;
-        return _find_scapegoat(nodes[node].parent);
+        while(node != root_node)
+        {
+            bool e1 = _get_node_size(nodes[node].left_child) <= a * _get_node_size(node);
+            bool e2 = _get_node_size(nodes[node].right_child) <= a * _get_node_size(node);
+            if(!(e1 && e2))
+                return node;
+            node = nodes[node].parent;
+        }
+        return node;
     }
     int _get_free_node(const T& v = T())
     {
@@ -101,172 +142,383 @@ protected:
             return nodes.size() - 1;
         }
     }
+    bool _empty() const
+    {
+        return !nodes.size() || (nodes.size() == unused_nodes.size());
+    }
+    int _next(int node) const
+    {
+        if(nodes[node].right_child != -1)
+        {
+            node = nodes[node].right_child;
+            while(nodes[node].left_child != -1)
+                node = nodes[node].left_child;
+            return node;
+        }
+        while(nodes[node].parent != -1 && nodes[nodes[node].parent].right_child == node)
+            node = nodes[node].parent;
+        return nodes[node].parent;
+    }
+    int _prev(int node) const
+    {
+        if(nodes[node].left_child != -1)
+        {
+            node = nodes[node].left_child;
+            while(nodes[node].right_child != -1)
+                node = nodes[node].right_child;
+            return node;
+        }
+        while(nodes[node].parent != -1 && nodes[nodes[node].parent].left_child == node)
+            node = nodes[node].parent;
+        return nodes[node].parent;
+    }
+    int _extreme(bool left) const
+    {
+        if(_empty())
+            return -1;
+        int node = root_node;
+        while(true)
+        {
+            int next = left ? nodes[node].left_child : nodes[node].right_child;
+            if(next == -1)
+                return node;
+            node = next;
+        }
+    }
+    // Appends the nodes of the subtree rooted in `node` to `v`, in order.
+    // The nodes still to be visited wait in `rebuild_stack`.
     void _inorder(int node, std::vector<int>& v)
     {
-        if(node == -1)
-            return;
-        _inorder(nodes[node].left_child, v);
-        v.push_back(node);
-        _inorder(nodes[node].right_child, v);
+        rebuild_stack.clear();
+        while(node != -1 || !rebuild_stack.empty())
+        {
+            while(node != -1)
+            {
+                rebuild_stack.push_back(node);
+                node = nodes[node].left_child;
+            }
+            node = rebuild_stack.back();
+            rebuild_stack.pop_back();
+            v.push_back(node);
+            node = nodes[node].right_child;
+        }
     }
+    // Links r[s..e) into a perfectly balanced subtree under `parent`. The
+    // pending ranges are kept on a small fixed stack: the result is balanced,
+    // so its depth is logarithmic.
     void _rr(int s, int e, std::vector<int>& r, int parent, bool left)
     {
-        if(s == e)
+        struct range
+        {
+            int s, e, parent;
+            bool left;
+        };
+        range stack[2 * sizeof(int) * CHAR_BIT];
+        int top = 0;
+        stack[top++] = {s, e, parent, left};
+        while(top)
+        {
+            range cur = stack[--top];
+            if(cur.s == cur.e)
+                continue;
+            int m = (cur.s + cur.e) / 2;
+            nodes[r[m]].left_child = -1;
+            nodes[r[m]].right_child = -1;
+            nodes[r[m]].parent = cur.parent;
+            nodes[r[m]].tree_size = cur.e - cur.s;
+            if(cur.parent == -1)
+                root_node = r[m];
+            else if(cur.left)
+                nodes[cur.parent].left_child = r[m];
+            else
+                nodes[cur.parent].right_child = r[m];
+            stack[top++] = {m + 1, cur.e, r[m], false};
+            stack[top++] = {cur.s, m, r[m], true};
+        }
+    }
+    // Appends to layout_order the in-order ranks of the top `h` levels of the
+    // subtree _rr builds from [s, e), in van Emde Boas order. The recursion
+    // depth is bounded by the height of the tree.
+    void _veb(int s, int e, int h)
+    {
+        if(s >= e || h == 0)
             return;
+        if(h == 1)
+        {
+            layout_order.push_back((s + e) / 2);
+            return;
+        }
+        int top = h / 2;
+        _veb(s, e, top);
+        _veb_bottom(s, e, top, h - top);
+    }
+    // Lays out, left to right, the subtrees rooted `d` levels below [s, e)
+    void _veb_bottom(int s, int e, int d, int h)
+    {
+        if(s >= e)
+            return;
+        if(d == 0)
+        {
+            _veb(s, e, h);
+            return;
+        }
         int m = (s + e) / 2;
-        nodes[r[m]].left_child = -1;
-        nodes[r[m]].right_child = -1;
-        nodes[r[m]].parent = parent;
-        nodes[r[m]].tree_size = e - s;
-        if(parent == -1)
-            root_node = r[m];
-        if(left)
+        _veb_bottom(s, m, d - 1, h);
+        _veb_bottom(m + 1, e, d - 1, h);
+    }
+    // Rebuilds the whole tree from the nodes listed in order in
+    // rebuild_buffer, moving them to the front of `nodes` in the order given
+    // by Layout and dropping the unused ones
+    void _relayout()
+    {
+        int n = rebuild_buffer.size();
+        layout_order.clear();
+        if(std::is_same<Layout, policy::bfs_order>::value)
         {
-            if(parent != -1)
-                nodes[parent].left_child = r[m];
+            // The pending ranges are stored as pairs after the ranks
+            layout_source.clear();
+            layout_source.push_back(0);
+            layout_source.push_back(n);
+            for(size_t i = 0; i < layout_source.size(); i += 2)
+            {
+                int s = layout_source[i];
+                int e = layout_source[i + 1];
+                if(s >= e)
+                    continue;
+                int m = (s + e) / 2;
+                layout_order.push_back(m);
+                layout_source.insert(layout_source.end(), {s, m, m + 1, e});
+            }
         }
         else
         {
-            if(parent != -1)
-                nodes[parent].right_child = r[m];
+            int h = 0;
+            while((1LL << h) <= n)
+                h++;
+            _veb(0, n, h);
         }
-        if(s == e - 1)
-            return;
-        _rr(s, m, r, r[m], true);
-        _rr(m + 1, e, r, r[m], false);
+        assert((int)layout_order.size() == n);
+        // Slot k receives the node currently at layout_source[k]; the free
+        // nodes fill the slots past n
+        layout_source.resize(nodes.size());
+        for(int k = 0; k < n; k++)
+            layout_source[k] = rebuild_buffer[layout_order[k]];
+        for(size_t k = n; k < nodes.size(); k++)
+        {
+            layout_source[k] = unused_nodes.front();
+            unused_nodes.pop();
+        }
+        // Apply the permutation cycle by cycle
+        for(size_t k = 0; k < nodes.size(); k++)
+        {
+            if(layout_source[k] == (int)k)
+                continue;
+            _scapegoat_node<T> tmp = std::move(nodes[k]);
+            size_t j = k;
+            while(layout_source[j] != (int)k)
+            {
+                size_t next = layout_source[j];
+                nodes[j] = std::move(nodes[next]);
+                layout_source[j] = j;
+                j = next;
+            }
+            nodes[j] = std::move(tmp);
+            layout_source[j] = j;
+        }
+        nodes.erase(nodes.begin() + n, nodes.end());
+        for(int k = 0; k < n; k++)
+            rebuild_buffer[layout_order[k]] = k;
+        _rr(0, n, rebuild_buffer, -1, true);
     }
     void _rebalance(int node)
     {
         int scp = node;
         int scp_parent = nodes[node].parent;
-        std::vector<int> rebalanced;
-        _inorder(node, rebalanced);
-        _rr(0, rebalanced.size(), rebalanced, scp_parent, (scp_parent == -1) || (scp == nodes[scp_parent].left_child));
+        rebuild_buffer.clear();
+        _inorder(node, rebuild_buffer);
+        if(scp_parent == -1 && !std::is_same<Layout, policy::allocation_order>::value)
+            _relayout();
+        else
+            _rr(0, rebuild_buffer.size(), rebuild_buffer, scp_parent, (scp_parent == -1) || (scp == nodes[scp_parent].left_child));
     }
-    void _insert(const T& v)
+    // Inserts v unless already present, walking down only once. Sizes are
+    // updated on the way back up, once the key is known to be new.
+    bool _insert(const T& v)
     {
         if(!nodes.size() || (nodes.size() == unused_nodes.size()))
         {
             root_node = _get_free_node(v);
-            return;
+            return true;
         }
         int node = root_node;
-        int depth = 1;
+        unsigned depth = 1;
         while(true)
         {
-            nodes[node].tree_size++;
-            if(v < nodes[node].value)
-            {
-                if(nodes[node].left_child == -1)
-                {
-                    int tmp = _get_free_node(v);
-                    nodes[tmp].parent = node;
-                    nodes[node].left_child = tmp;
-                    break;
-                }
-                else
-                {
-                    node = nodes[node].left_child;
-                }
-            }
-            else
-            {
-                if(nodes[node].right_child == -1)
-                {
-                    int tmp = _get_free_node(v);
-                    nodes[tmp].parent = node;
-                    nodes[node].right_child = tmp;
-                    break;
-                }
-                else
-                {
-                    node = nodes[node].right_child;
-                }
-            }
+            if(nodes[node].value == v)
+                return false;
+            int& child = v < nodes[node].value ? nodes[node].left_child : nodes[node].right_child;
+            if(child == -1)
+                break;
+            node = child;
             depth++;
         }
-        bool balanced = depth <= ((log(nodes[root_node].tree_size) / log(1.0 / a)) + 1.0);
+        int tmp = _get_free_node(v);
+        nodes[tmp].parent = node;
+        if(v < nodes[node].value)
+            nodes[node].left_child = tmp;
+        else
+            nodes[node].right_child = tmp;
+        for(int i = node; i != -1; i = nodes[i].parent)
+            nodes[i].tree_size++;
+        // depth <= log(size) / log(1 / a) + 1, without the logarithms
+        bool balanced = depth < min_size_for_depth.size() && nodes[root_node].tree_size >= min_size_for_depth[depth];
         if(balanced)
-            return;
+            return true;
         int scp = _find_scapegoat(node);
         _rebalance(scp);
+        return true;
     }
     void _decrease(int node)
     {
-        if(node == -1)
-            return;
-        nodes[node].tree_size--;
-        _decrease(nodes[node].parent);
+        for(; node != -1; node = nodes[node].parent)
+            nodes[node].tree_size--;
     }
     void _erase(int node)
     {
-        if(nodes[node].left_child == -1 && nodes[node].right_child == -1)
+        // Push the value down until it sits in a leaf
+        while(nodes[node].left_child != -1 || nodes[node].right_child != -1)
         {
-            int parent = nodes[node].parent;
-            if(parent == -1)
-            {
-                unused_nodes.push(node);
-                return;
-            }
-            if(node == nodes[parent].left_child)
+            int rnode;
+            if(nodes[node].left_child != -1)
             {
-                nodes[parent].left_child = -1;
+                rnode = nodes[node].left_child;
+                while(nodes[rnode].right_child != -1)
+                    rnode = nodes[rnode].right_child;
             }
             else
             {
-                nodes[parent].right_child = -1;
+                rnode = nodes[node].right_child;
+                while(nodes[rnode].left_child != -1)
+                    rnode = nodes[rnode].left_child;
             }
-            _decrease(parent);
+            std::swap(nodes[rnode].value, nodes[node].value);
+            node = rnode;
+        }
+        int parent = nodes[node].parent;
+        if(parent == -1)
+        {
             unused_nodes.push(node);
-            bool balanced = nodes[root_node].tree_size > a * max_size;
-            if(!balanced)
-            {
-                _rebalance(root_node);
-                max_size = nodes[root_node].tree_size;
-            }
             return;
         }
-        else if(nodes[node].left_child != -1)
+        if(node == nodes[parent].left_child)
         {
-            int rnode = nodes[node].left_child;
-            while(nodes[rnode].right_child != -1)
-                rnode = nodes[rnode].right_child;
-            std::swap(nodes[rnode].value, nodes[node].value);
-            _erase(rnode);
+            nodes[parent].left_child = -1;
         }
         else
         {
-            int rnode = nodes[node].right_child;
-            while(nodes[rnode].left_child != -1)
-                rnode = nodes[rnode].left_child;
-            std::swap(nodes[rnode].value, nodes[node].value);
-            _erase(rnode);
+            nodes[parent].right_child = -1;
+        }
+        _decrease(parent);
+        unused_nodes.push(node);
+        bool balanced = nodes[root_node].tree_size > a * max_size;
+        if(!balanced)
+        {
+            _rebalance(root_node);
+            max_size = nodes[root_node].tree_size;
         }
     }
 
 public:
+    // In-order iterator over the values. Inserting keeps iterators valid,
+    // erasing invalidates all of them.
+    class iterator
+    {
+    protected:
+        const scapegoat* tree;
+        int node;
+        iterator(const scapegoat* t, int n)
+        {
+            tree = t;
+            node = n;
+        }
+
+    public:
+        typedef std::bidirectional_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef const T* pointer;
+        typedef const T& reference;
+        iterator()
+        {
+            tree = nullptr;
+            node = -1;
+        }
+        reference operator*() const
+        {
+            return tree->nodes[node].value;
+        }
+        pointer operator->() const
+        {
+            return &tree->nodes[node].value;
+        }
+        iterator& operator++()
+        {
+            node = tree->_next(node);
+            return *this;
+        }
+        iterator operator++(int)
+        {
+            iterator tmp = *this;
+            ++*this;
+            return tmp;
+        }
+        // Decrementing end() gives the largest value
+        iterator& operator--()
+        {
+            node = node == -1 ? tree->_extreme(false) : tree->_prev(node);
+            return *this;
+        }
+        iterator operator--(int)
+        {
+            iterator tmp = *this;
+            --*this;
+            return tmp;
+        }
+        bool operator==(const iterator& o) const
+        {
+            return node == o.node;
+        }
+        bool operator!=(const iterator& o) const
+        {
+            return node != o.node;
+        }
+        friend class scapegoat;
+    };
+    typedef iterator const_iterator;
     scapegoat(double balance_factor = 2.0 / 3.0)
     {
         assert(balance_factor > 0.5 && balance_factor < 1.0);
         a = balance_factor;
         root_node = -1;
         max_size = 0;
+        min_size_for_depth.push_back(0);
+        for(double s = 1.0; s <= UINT_MAX; s /= a)
+            min_size_for_depth.push_back(ceil(s - 1e-9));
     }
-    bool find(const T& v)
+    bool find(const T& v) const
     {
         return nodes.size() && (nodes.size() != unused_nodes.size()) && (_find(v, root_node) != -1);
     }
     bool insert(const T& v)
     {
-        if(find(v))
+        if(!_insert(v))
             return false;
-        _insert(v);
         max_size = std::max(max_size, nodes[root_node].tree_size);
         return true;
     }
     bool erase(const T& v)
     {
-        if(!nodes.size())
+        if(_empty())
             return false;
         int node = _find(v, root_node);
         if(node == -1)
@@ -274,11 +526,287 @@ public:
         _erase(node);
         return true;
     }
-    size_t size()
+    size_t size() const
     {
         if(nodes.size() == 0 || (nodes.size() == unused_nodes.size()))
             return 0;
         return nodes[root_node].tree_size;
     }
+    void clear()
+    {
+        nodes.clear();
+        unused_nodes = std::queue<int>();
+        root_node = -1;
+        max_size = 0;
+    }
+    // Replaces the content with the ascending range [first, last) in O(n),
+    // building a perfectly balanced tree; repeated values are kept once
+    template <typename InputIt>
+    void assign_sorted(InputIt first, InputIt last)
+    {
+        clear();
+        if constexpr(std::is_base_of<std::forward_iterator_tag,
+                                     typename std::iterator_traits<InputIt>::iterator_category>::value)
+            nodes.reserve(std::distance(first, last));
+        for(; first != last; ++first)
+        {
+            assert(!nodes.size() || !(*first < nodes.back().value));
+            if(nodes.size() && nodes.back().value == *first)
+                continue;
+            nodes.push_back(_scapegoat_node<T>(*first));
+        }
+        rebuild_buffer.resize(nodes.size());
+        for(size_t i = 0; i < nodes.size(); i++)
+            rebuild_buffer[i] = i;
+        if(!std::is_same<Layout, policy::allocation_order>::value)
+            _relayout();
+        else
+            _rr(0, rebuild_buffer.size(), rebuild_buffer, -1, true);
+        max_size = nodes.size();
+    }
+    // Moves all the values of `o` into this tree in O(n + m), leaving `o`
+    // empty
+    void merge(scapegoat& o)
+    {
+        if(&o == this)
+            return;
+        std::vector<T> merged;
+        merged.reserve(size() + o.size());
+        rebuild_buffer.clear();
+        if(!_empty())
+            _inorder(root_node, rebuild_buffer);
+        o.rebuild_buffer.clear();
+        if(!o._empty())
+            o._inorder(o.root_node, o.rebuild_buffer);
+        auto i = rebuild_buffer.begin();
+        auto j = o.rebuild_buffer.begin();
+        while(i != rebuild_buffer.end() || j != o.rebuild_buffer.end())
+        {
+            if(j == o.rebuild_buffer.end() || (i != rebuild_buffer.end() && nodes[*i].value < o.nodes[*j].value))
+                merged.push_back(std::move(nodes[*i++].value));
+            else if(i == rebuild_buffer.end() || o.nodes[*j].value < nodes[*i].value)
+                merged.push_back(std::move(o.nodes[*j++].value));
+            else
+            {
+                merged.push_back(std::move(nodes[*i++].value));
+                j++;
+            }
+        }
+        o.clear();
+        assign_sorted(std::make_move_iterator(merged.begin()), std::make_move_iterator(merged.end()));
+    }
+    // Keeps the values less than `v` and returns a tree, with the same balance
+    // factor, holding the others. Both are rebuilt in O(n).
+    scapegoat split(const T& v)
+    {
+        scapegoat upper(a);
+        std::vector<T> lower;
+        std::vector<T> higher;
+        rebuild_buffer.clear();
+        if(!_empty())
+            _inorder(root_node, rebuild_buffer);
+        for(int i: rebuild_buffer)
+        {
+            if(nodes[i].value < v)
+                lower.push_back(std::move(nodes[i].value));
+            else
+                higher.push_back(std::move(nodes[i].value));
+        }
+        assign_sorted(std::make_move_iterator(lower.begin()), std::make_move_iterator(lower.end()));
+        upper.assign_sorted(std::make_move_iterator(higher.begin()), std::make_move_iterator(higher.end()));
+        return upper;
+    }
+    // k-th smallest value, counting from 0
+    const T& select(size_t k) const
+    {
+        assert(!_empty() && k < nodes[root_node].tree_size);
+        int node = root_node;
+        while(true)
+        {
+            size_t left_size = _get_node_size(nodes[node].left_child);
+            if(k < left_size)
+            {
+                node = nodes[node].left_child;
+            }
+            else if(k == left_size)
+            {
+                return nodes[node].value;
+            }
+            else
+            {
+                k -= left_size + 1;
+                node = nodes[node].right_child;
+            }
+        }
+    }
+    // Number of values less than v
+    size_t rank(const T& v) const
+    {
+        if(_empty())
+            return 0;
+        size_t r = 0;
+        int node = root_node;
+        while(node != -1)
+        {
+            if(nodes[node].value < v)
+            {
+                r += _get_node_size(nodes[node].left_child) + 1;
+                node = nodes[node].right_child;
+            }
+            else
+            {
+                node = nodes[node].left_child;
+            }
+        }
+        return r;
+    }
+    // Number of values in [lo, hi)
+    size_t count_range(const T& lo, const T& hi) const
+    {
+        if(!(lo < hi))
+            return 0;
+        return rank(hi) - rank(lo);
+    }
+    iterator begin() const
+    {
+        return iterator(this, _extreme(true));
+    }
+    iterator end() const
+    {
+        return iterator(this, -1);
+    }
+};
+
+// scapegoat shared between threads, for read-mostly workloads. Two copies of
+// the tree are kept (Left-Right): readers never block and never take a lock,
+// they only announce themselves on a per-thread counter, while writers are
+// serialized, update the copy nobody is reading, switch the readers over and
+// wait for the old readers to leave before updating the other copy.
+template <typename T, typename Layout = policy::allocation_order>
+class concurrent_scapegoat
+{
+protected:
+    typedef scapegoat<T, Layout> tree_type;
+    static constexpr size_t read_slots = 64;
+    // Each counter on its own cache line, so that readers on different
+    // threads do not contend
+    class alignas(64) _read_counter
+    {
+    public:
+        std::atomic<long> value;
+        _read_counter() : value(0)
+        {
+        }
+    };
+    class _read_guard
+    {
+    protected:
+        std::atomic<long>& counter;
+
+    public:
+        _read_guard(std::atomic<long>& c) : counter(c)
+        {
+            counter.fetch_add(1);
+        }
+        ~_read_guard()
+        {
+            counter.fetch_sub(1);
+        }
+    };
+    tree_type trees[2];
+    // Copy the readers are sent to
+    std::atomic<int> left_right;
+    // Set of counters new readers announce themselves on
+    std::atomic<int> version;
+    mutable _read_counter readers[2][read_slots];
+    std::mutex writer;
+    static size_t _slot()
+    {
+        static std::atomic<size_t> next_slot(0);
+        thread_local size_t slot = next_slot.fetch_add(1) % read_slots;
+        return slot;
+    }
+    void _wait_readers(int v)
+    {
+        for(size_t i = 0; i < read_slots; i++)
+        {
+            while(readers[v][i].value.load())
+                std::this_thread::yield();
+        }
+    }
+    // Applies `f` to both copies, one at a time, and returns the result of
+    // the second application
+    template <typename F>
+    auto _write(F f)
+    {
+        std::lock_guard<std::mutex> lock(writer);
+        int lr = left_right.load(std::memory_order_relaxed);
+        f(trees[!lr]);
+        left_right.store(!lr);
+        int v = version.load(std::memory_order_relaxed);
+        _wait_readers(!v);
+        version.store(!v);
+        _wait_readers(v);
+        return f(trees[lr]);
+    }
+
+public:
+    concurrent_scapegoat(double balance_factor = 2.0 / 3.0)
+        : trees{tree_type(balance_factor), tree_type(balance_factor)}, left_right(0), version(0)
+    {
+    }
+    concurrent_scapegoat(const concurrent_scapegoat&) = delete;
+    concurrent_scapegoat& operator=(const concurrent_scapegoat&) = delete;
+    // Calls `f` on a consistent snapshot of the tree and returns its result.
+    // Wait-free, but writers wait for `f` to return, so it should be short;
+    // references into the tree must not outlive it. Queries that depend on
+    // each other, such as size() and then select(), belong in one call: a
+    // writer can run between two separate ones.
+    template <typename F>
+    auto read(F f) const
+    {
+        _read_guard guard(readers[version.load()][_slot()].value);
+        return f(static_cast<const tree_type&>(trees[left_right.load()]));
+    }
+    bool find(const T& v) const
+    {
+        return read([&](const tree_type& t) { return t.find(v); });
+    }
+    size_t rank(const T& v) const
+    {
+        return read([&](const tree_type& t) { return t.rank(v); });
+    }
+    // Copies the k-th smallest value to `out`, or returns false if the tree
+    // holds k values or fewer; the bound is checked on the snapshot read
+    bool select(size_t k, T& out) const
+    {
+        return read([&](const tree_type& t)
+        {
+            if(k >= t.size())
+                return false;
+            out = t.select(k);
+            return true;
+        });
+    }
+    size_t count_range(const T& lo, const T& hi) const
+    {
+        return read([&](const tree_type& t) { return t.count_range(lo, hi); });
+    }
+    size_t size() const
+    {
+        return read([](const tree_type& t) { return t.size(); });
+    }
+    bool insert(const T& v)
+    {
+        return _write([&](tree_type& t) { return t.insert(v); });
+    }
+    bool erase(const T& v)
+    {
+        return _write([&](tree_type& t) { return t.erase(v); });
+    }
+    void clear()
+    {
+        _write([](tree_type& t) { t.clear(); });
+    }
 };
 }
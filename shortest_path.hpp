@@ -0,0 +1,280 @@
+/*
+ * Author: Dario Ostuni <dario.ostuni@gmail.com>
+ * License: Apache 2.0
+ *
+ * Time complexity (with policy::pairing): O(E + Vlog(V)) amortized in practice
+ * Time complexity (with policy::binomial): O((E + V)log(V))
+ * Time complexity (with policy::lazy): O(Elog(E))
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "binomial_heap.hpp"
+#include "pairing_heap.hpp"
+
+namespace ostuni {
+
+// Directed graph in compressed sparse row form: the arcs leaving `v` are the
+// indices in [begin(v), end(v))
+template<typename W>
+class csr_graph
+{
+protected:
+    std::vector<size_t> offset;
+    std::vector<size_t> to;
+    std::vector<W> w;
+public:
+    csr_graph(size_t n, const std::vector<std::tuple<size_t, size_t, W>>& edges) : offset(n + 1, 0), to(edges.size()), w(edges.size())
+    {
+        for(const auto& i: edges)
+        {
+            assert(std::get<0>(i) < n && std::get<1>(i) < n);
+            offset[std::get<0>(i) + 1]++;
+        }
+        for(size_t i = 0; i < n; i++)
+            offset[i + 1] += offset[i];
+        std::vector<size_t> pos(offset.begin(), offset.end() - 1);
+        for(const auto& i: edges)
+        {
+            size_t p = pos[std::get<0>(i)]++;
+            to[p] = std::get<1>(i);
+            w[p] = std::get<2>(i);
+        }
+    }
+    size_t size() const
+    {
+        return offset.size() - 1;
+    }
+    size_t begin(size_t v) const
+    {
+        return offset[v];
+    }
+    size_t end(size_t v) const
+    {
+        return offset[v + 1];
+    }
+    size_t target(size_t arc) const
+    {
+        return to[arc];
+    }
+    const W& weight(size_t arc) const
+    {
+        return w[arc];
+    }
+};
+
+namespace policy {
+
+// Priority queues for shortest_paths() and astar()
+
+// pairing_heap_container, updating keys through node handles
+class pairing
+{
+};
+
+// binomial_heap, updating keys through handles
+class binomial
+{
+};
+
+// std::priority_queue, pushing a new entry on every update and skipping the
+// stale ones when they come out
+class lazy
+{
+};
+
+}
+
+template<typename W>
+class _sp_entry
+{
+public:
+    W key;
+    size_t vertex;
+    bool operator <(const _sp_entry& o) const
+    {
+        return key < o.key;
+    }
+    bool operator >(const _sp_entry& o) const
+    {
+        return o.key < key;
+    }
+};
+
+template<typename W, typename U>
+class _sp_queue;
+
+template<typename W>
+class _sp_queue<W, policy::pairing>
+{
+protected:
+    typedef pairing_heap_container<_sp_entry<W>> heap_type;
+    heap_type heap;
+    std::vector<typename heap_type::node_type*> handle;
+public:
+    _sp_queue(size_t n) : handle(n, nullptr)
+    {
+    }
+    void update(size_t v, const W& key)
+    {
+        if(handle[v])
+            heap.decrease_key(handle[v], _sp_entry<W>{key, v});
+        else
+            handle[v] = heap.push(_sp_entry<W>{key, v});
+    }
+    size_t next()
+    {
+        return heap.pop().vertex;
+    }
+    bool empty() const
+    {
+        return heap.empty();
+    }
+};
+
+template<typename W>
+class _sp_queue<W, policy::binomial>
+{
+protected:
+    typedef binomial_heap<_sp_entry<W>> heap_type;
+    heap_type heap;
+    std::vector<typename heap_type::handle_type> handle;
+    std::vector<bool> queued;
+public:
+    _sp_queue(size_t n) : handle(n), queued(n, false)
+    {
+    }
+    void update(size_t v, const W& key)
+    {
+        if(queued[v])
+        {
+            heap.decrease_key(handle[v], _sp_entry<W>{key, v});
+        }
+        else
+        {
+            handle[v] = heap.push(_sp_entry<W>{key, v});
+            queued[v] = true;
+        }
+    }
+    size_t next()
+    {
+        return heap.pop().vertex;
+    }
+    bool empty() const
+    {
+        return heap.empty();
+    }
+};
+
+template<typename W>
+class _sp_queue<W, policy::lazy>
+{
+protected:
+    std::priority_queue<_sp_entry<W>, std::vector<_sp_entry<W>>, std::greater<_sp_entry<W>>> pq;
+public:
+    _sp_queue(size_t)
+    {
+    }
+    void update(size_t v, const W& key)
+    {
+        pq.push(_sp_entry<W>{key, v});
+    }
+    // May return a vertex that was already settled, the caller skips it
+    size_t next()
+    {
+        size_t v = pq.top().vertex;
+        pq.pop();
+        return v;
+    }
+    bool empty() const
+    {
+        return pq.empty();
+    }
+};
+
+// Settles vertices in order of distance + heuristic, stopping early once
+// `target` is settled. The heuristic must be consistent.
+template<typename W, typename U, typename H>
+static void _sp_search(const csr_graph<W>& g, size_t source, size_t target, const H& heuristic, std::vector<W>& dist, std::vector<size_t>* predecessor)
+{
+    using namespace std;
+    size_t n = g.size();
+    assert(source < n);
+    const W inf = numeric_limits<W>::max();
+    dist.assign(n, inf);
+    if(predecessor)
+        predecessor->assign(n, n);
+    vector<bool> settled(n, false);
+    _sp_queue<W, U> q(n);
+    dist[source] = W(0);
+    q.update(source, heuristic(source));
+    while(!q.empty())
+    {
+        size_t node = q.next();
+        if(settled[node])
+            continue;
+        settled[node] = true;
+        if(node == target)
+            return;
+        for(size_t i = g.begin(node); i < g.end(node); i++)
+        {
+            size_t next = g.target(i);
+            if(settled[next])
+                continue;
+            W d = dist[node] + g.weight(i);
+            if(d < dist[next])
+            {
+                dist[next] = d;
+                if(predecessor)
+                    (*predecessor)[next] = node;
+                q.update(next, d + heuristic(next));
+            }
+        }
+    }
+}
+
+// Distances from `source` to every vertex, numeric_limits<W>::max() for the
+// unreachable ones. If given, `predecessor` receives the shortest path tree,
+// with n marking the source and the unreachable vertices.
+template<typename W, typename U = policy::pairing>
+static std::vector<W> shortest_paths(const csr_graph<W>& g, size_t source, std::vector<size_t>* predecessor = nullptr)
+{
+    std::vector<W> dist;
+    _sp_search<W, U>(g, source, g.size(), [](size_t) { return W(0); }, dist, predecessor);
+    return dist;
+}
+
+// Distance from `source` to `target`, numeric_limits<W>::max() if it cannot
+// be reached. `heuristic(v)` must be a consistent lower bound on the distance
+// from v to target. If given, `path` receives the vertices from source to
+// target.
+template<typename W, typename U = policy::pairing, typename H>
+static W astar(const csr_graph<W>& g, size_t source, size_t target, const H& heuristic, std::vector<size_t>* path = nullptr)
+{
+    using namespace std;
+    assert(target < g.size());
+    vector<W> dist;
+    vector<size_t> predecessor;
+    _sp_search<W, U>(g, source, target, heuristic, dist, path ? &predecessor : nullptr);
+    if(path)
+    {
+        path->clear();
+        if(dist[target] != numeric_limits<W>::max())
+        {
+            for(size_t v = target; v != g.size(); v = predecessor[v])
+                path->push_back(v);
+            reverse(path->begin(), path->end());
+        }
+    }
+    return dist[target];
+}
+
+}
@@ -0,0 +1,243 @@
+/*
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=undefined test/flow_test.cpp -o flow_test -pthread && ./flow_test
+ * The parallel engine is also worth running with -fsanitize=thread.
+*/
+
+#undef NDEBUG
+
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <random>
+
+#include "../flow.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+typedef vector<tuple<size_t, size_t, long long>> edge_list;
+
+// Edmonds-Karp on a plain arc list, arc a paired with arc a ^ 1
+static long long reference(size_t n, const edge_list& edges, size_t source, size_t sink)
+{
+    vector<size_t> to, tail;
+    vector<long long> cap;
+    for(const auto& i: edges)
+    {
+        tail.push_back(get<0>(i));
+        to.push_back(get<1>(i));
+        cap.push_back(get<2>(i));
+        tail.push_back(get<1>(i));
+        to.push_back(get<0>(i));
+        cap.push_back(0);
+    }
+    long long value = 0;
+    while(true)
+    {
+        vector<size_t> parent(n, SIZE_MAX);
+        vector<size_t> queue(1, source);
+        vector<bool> seen(n, false);
+        seen[source] = true;
+        for(size_t k = 0; k < queue.size() && !seen[sink]; k++)
+        {
+            for(size_t a = 0; a < to.size(); a++)
+            {
+                if(tail[a] == queue[k] && cap[a] > 0 && !seen[to[a]])
+                {
+                    seen[to[a]] = true;
+                    parent[to[a]] = a;
+                    queue.push_back(to[a]);
+                }
+            }
+        }
+        if(!seen[sink])
+            return value;
+        long long quantity = LLONG_MAX;
+        for(size_t v = sink; v != source; v = tail[parent[v]])
+            quantity = min(quantity, cap[parent[v]]);
+        for(size_t v = sink; v != source; v = tail[parent[v]])
+        {
+            cap[parent[v]] -= quantity;
+            cap[parent[v] ^ 1] += quantity;
+        }
+        value += quantity;
+    }
+}
+
+// The edge flows respect the capacities and are conserved everywhere but at
+// the source and the sink, the sink receives `value`, the source and the
+// sink are on their sides, and cut_edges lists exactly the edges crossing
+// the cut, whose capacities add up to `value`
+static void check(size_t n, const edge_list& edges, size_t source, size_t sink, long long value, const flow_result<long long>& r)
+{
+    assert(r.value == value);
+    assert(r.edge_flow.size() == edges.size() && r.source_side.size() == n);
+    assert(r.source_side[source] && !r.source_side[sink]);
+    vector<long long> balance(n, 0);
+    for(size_t i = 0; i < edges.size(); i++)
+    {
+        long long f = r.edge_flow[i];
+        assert(f >= 0 && f <= get<2>(edges[i]));
+        balance[get<0>(edges[i])] -= f;
+        balance[get<1>(edges[i])] += f;
+    }
+    for(size_t v = 0; v < n; v++)
+        assert(v == source || v == sink || balance[v] == 0);
+    assert(balance[sink] == value);
+    long long cut = 0;
+    size_t k = 0;
+    for(size_t i = 0; i < edges.size(); i++)
+    {
+        if(r.source_side[get<0>(edges[i])] && !r.source_side[get<1>(edges[i])])
+        {
+            assert(k < r.cut_edges.size() && r.cut_edges[k] == i);
+            assert(r.edge_flow[i] == get<2>(edges[i]));
+            cut += get<2>(edges[i]);
+            k++;
+        }
+    }
+    assert(k == r.cut_edges.size() && cut == value);
+}
+
+// Small multigraph with self-loops, antiparallel and zero-capacity edges
+static edge_list random_graph(mt19937& r, size_t& n, size_t& source, size_t& sink)
+{
+    n = 2 + r() % 20;
+    edge_list edges;
+    for(size_t i = r() % 80; i > 0; i--)
+        edges.emplace_back(r() % n, r() % n, (long long)(r() % 10));
+    source = r() % n;
+    sink = (source + 1 + r() % (n - 1)) % n;
+    return edges;
+}
+
+template<typename U>
+static void check_solver(size_t n, const edge_list& edges, size_t source, size_t sink, long long value)
+{
+    assert((flow<long long, U>(n, edges, source, sink)) == value);
+    check(n, edges, source, sink, value, flow_and_cut<long long, U>(n, edges, source, sink));
+}
+
+static void test_solvers(unsigned seed)
+{
+    mt19937 r(seed);
+    for(int it = 0; it < 20000; it++)
+    {
+        size_t n, source, sink;
+        edge_list edges = random_graph(r, n, source, sink);
+        long long value = reference(n, edges, source, sink);
+        check_solver<policy::max_label>(n, edges, source, sink, value);
+        check_solver<policy::fifo>(n, edges, source, sink, value);
+        check_solver<policy::dinic>(n, edges, source, sink, value);
+        check_solver<policy::boykov_kolmogorov>(n, edges, source, sink, value);
+        push_relabel<long long, policy::max_label> p(n, edges, source, sink);
+        assert(p.max_preflow() == value);
+        check(n, edges, source, sink, value, p.result());
+        // flow() would use one thread per core, so the count is set here
+        push_relabel<long long, policy::parallel> q(n, edges, source, sink);
+        q.set_threads(1 + it % 4);
+        assert(q.max_preflow() == value);
+        check(n, edges, source, sink, value, q.result());
+    }
+}
+
+// Grids big enough for the threads of the parallel engine to push into each
+// other's vertices and to run several global relabels
+static void test_parallel_grids(unsigned seed)
+{
+    mt19937 r(seed);
+    for(int it = 0; it < 8; it++)
+    {
+        size_t w = 20 + r() % 30, h = 20 + r() % 30;
+        size_t n = w * h + 2, source = w * h, sink = w * h + 1;
+        edge_list edges;
+        for(size_t v = 0; v < w * h; v++)
+        {
+            if(v % w + 1 < w)
+            {
+                edges.emplace_back(v, v + 1, (long long)(r() % 100));
+                edges.emplace_back(v + 1, v, (long long)(r() % 100));
+            }
+            if(v + w < w * h)
+            {
+                edges.emplace_back(v, v + w, (long long)(r() % 100));
+                edges.emplace_back(v + w, v, (long long)(r() % 100));
+            }
+            if(r() % 4 == 0)
+                edges.emplace_back(source, v, (long long)(r() % 200));
+            if(r() % 4 == 0)
+                edges.emplace_back(v, sink, (long long)(r() % 200));
+        }
+        long long value = flow<long long, policy::max_label>(n, edges, source, sink);
+        for(size_t threads = 1; threads <= 4; threads++)
+        {
+            push_relabel<long long, policy::parallel> p(n, edges, source, sink);
+            p.set_threads(threads);
+            p.set_global_relabel_frequency(threads % 2 ? 0.5 : 4.0);
+            assert(p.max_preflow() == value);
+            check(n, edges, source, sink, value, p.result());
+        }
+    }
+}
+
+// One to four threads for the parallel engine, nothing for the others
+template<typename U>
+static void set_threads(push_relabel<long long, U>&, int)
+{
+}
+
+static void set_threads(push_relabel<long long, policy::parallel>& p, int it)
+{
+    p.set_threads(1 + it % 4);
+}
+
+// Random set_capacity() and add_edge() batches, each followed by resolve()
+// or max_flow(), checked against a recomputation on the updated edges
+template<typename U>
+static void test_resolve(unsigned seed)
+{
+    mt19937 r(seed);
+    for(int it = 0; it < 3000; it++)
+    {
+        size_t n, source, sink;
+        edge_list edges = random_graph(r, n, source, sink);
+        push_relabel<long long, U> p(n, edges, source, sink);
+        set_threads(p, it);
+        assert(p.max_preflow() == reference(n, edges, source, sink));
+        for(int step = 0; step < 6; step++)
+        {
+            for(unsigned k = 1 + r() % 3; k > 0; k--)
+            {
+                if(!edges.empty() && r() % 4)
+                {
+                    size_t i = r() % edges.size();
+                    long long c = r() % 10;
+                    get<2>(edges[i]) = c;
+                    p.set_capacity(i, c);
+                }
+                else
+                {
+                    size_t u = r() % n, v = r() % n;
+                    long long c = r() % 10;
+                    edges.emplace_back(u, v, c);
+                    assert(p.add_edge(u, v, c) == edges.size() - 1);
+                }
+            }
+            long long value = reference(n, edges, source, sink);
+            assert((step % 2 ? p.resolve() : p.max_flow()) == value);
+            if(step % 3 == 0)
+                check(n, edges, source, sink, value, p.result());
+        }
+    }
+}
+
+int main()
+{
+    test_solvers(1);
+    test_resolve<policy::max_label>(2);
+    test_resolve<policy::fifo>(3);
+    test_parallel_grids(4);
+    test_resolve<policy::parallel>(5);
+    puts("flow: ok");
+}
@@ -0,0 +1,414 @@
+/*
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O1 -g -fsanitize=address,undefined test/heap_test.cpp -o heap_test && ./heap_test
+*/
+
+#undef NDEBUG
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "../binomial_heap.hpp"
+#include "../pairing_heap.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+// Every value is (key << id_bits) | id, so values are distinct and a popped
+// value names the element it came from
+static const int id_bits = 20;
+
+static int make_value(int key, int id)
+{
+    return (key << id_bits) | id;
+}
+
+static int id_of(int value)
+{
+    return value & ((1 << id_bits) - 1);
+}
+
+// Value an outstanding handle points to, for each kind of heap
+static int value_of(const binomial_heap<int>&, binomial_heap<int>::handle_type h)
+{
+    return *h;
+}
+
+template<typename Pairing>
+static int value_of(const pairing_heap_container<int, less<int>, Pairing>&, pairing_heap<int, less<int>, Pairing>* h)
+{
+    return pairing_heap<int, less<int>, Pairing>::top(h);
+}
+
+template<typename Pairing>
+static int value_of(const compact_pairing_heap<int, less<int>, Pairing>& heap, uint32_t h)
+{
+    return heap.get(h);
+}
+
+// Random push, pop and decrease_key against std::multiset, keeping the
+// handle of every element still in the heap
+template<typename Heap, typename Handle>
+static void test_against_multiset(unsigned seed)
+{
+    mt19937 r(seed);
+    Heap heap;
+    multiset<int> s;
+    vector<Handle> handle;
+    vector<int> live;
+    vector<size_t> position;
+    for(int i = 0; i < 100000; i++)
+    {
+        unsigned op = r() % 10;
+        if(op < 4 || s.empty())
+        {
+            int id = handle.size();
+            int v = make_value(r() % 1024, id);
+            handle.push_back(heap.push(v));
+            position.push_back(live.size());
+            live.push_back(id);
+            s.insert(v);
+        }
+        else if(op < 7)
+        {
+            assert(heap.top() == *s.begin());
+            int v = heap.pop();
+            assert(v == *s.begin());
+            s.erase(s.begin());
+            int id = id_of(v);
+            live[position[id]] = live.back();
+            position[live.back()] = position[id];
+            live.pop_back();
+        }
+        else
+        {
+            int id = live[r() % live.size()];
+            int old_value = value_of(heap, handle[id]);
+            int v = make_value(r() % ((old_value >> id_bits) + 1), id);
+            heap.decrease_key(handle[id], v);
+            s.erase(old_value);
+            s.insert(v);
+        }
+        assert(heap.size() == s.size() && heap.empty() == s.empty());
+        if(!s.empty())
+            assert(heap.top() == *s.begin());
+    }
+    while(!s.empty())
+    {
+        assert(heap.pop() == *s.begin());
+        s.erase(s.begin());
+    }
+    assert(heap.empty());
+}
+
+// Pops everything from a copy and checks it against `s`
+template<typename Heap>
+static void check_contents(Heap heap, const multiset<int>& s)
+{
+    assert(heap.size() == s.size());
+    for(int v: s)
+        assert(heap.pop() == v);
+    assert(heap.empty());
+}
+
+// push, push_range, pop and merge, with copies, copy assignment and moves
+static void test_binomial_merge_copy(unsigned seed)
+{
+    mt19937 r(seed);
+    binomial_heap<int> heap;
+    multiset<int> s;
+    for(int i = 0; i < 20000; i++)
+    {
+        unsigned op = r() % 10;
+        if(op < 4)
+        {
+            int v = r() % 100000;
+            heap.push(v);
+            s.insert(v);
+        }
+        else if(op < 6 && !s.empty())
+        {
+            assert(heap.pop() == *s.begin());
+            s.erase(s.begin());
+        }
+        else if(op < 8)
+        {
+            binomial_heap<int> other;
+            vector<int> values(r() % 40);
+            for(int& v: values)
+                v = r() % 100000;
+            if(r() % 2)
+                other.push_range(values.begin(), values.end());
+            else
+                for(int v: values)
+                    other.push(v);
+            s.insert(values.begin(), values.end());
+            heap.merge(other);
+            assert(other.empty() && other.size() == 0);
+            heap.merge(heap);
+        }
+        else if(op < 9)
+        {
+            binomial_heap<int> copy(heap);
+            check_contents(copy, s);
+            binomial_heap<int> assigned;
+            assigned.push(-1);
+            assigned = heap;
+            assert(assigned.size() == heap.size());
+            binomial_heap<int> moved(std::move(assigned));
+            check_contents(std::move(moved), s);
+        }
+        else if(r() % 20 == 0)
+        {
+            heap.clear();
+            s.clear();
+        }
+        assert(heap.size() == s.size());
+        if(!s.empty())
+            assert(heap.top() == *s.begin());
+    }
+    check_contents(std::move(heap), s);
+}
+
+template<typename Pairing>
+static void test_container_merge(unsigned seed)
+{
+    typedef pairing_heap_container<int, less<int>, Pairing> heap_type;
+    mt19937 r(seed);
+    heap_type heap;
+    multiset<int> s;
+    for(int i = 0; i < 20000; i++)
+    {
+        unsigned op = r() % 10;
+        if(op < 4)
+        {
+            int v = r() % 100000;
+            heap.push(v);
+            s.insert(v);
+        }
+        else if(op < 7 && !s.empty())
+        {
+            assert(heap.pop() == *s.begin());
+            s.erase(s.begin());
+        }
+        else if(op < 9)
+        {
+            heap_type other;
+            for(unsigned k = r() % 40; k > 0; k--)
+            {
+                int v = r() % 100000;
+                other.push(v);
+                s.insert(v);
+            }
+            heap.merge(other);
+            assert(other.empty() && other.size() == 0);
+            other.push(1);
+            assert(other.pop() == 1);
+        }
+        else
+        {
+            heap_type moved(std::move(heap));
+            heap = std::move(moved);
+        }
+        assert(heap.size() == s.size());
+        if(!s.empty())
+            assert(heap.top() == *s.begin());
+    }
+    while(!s.empty())
+    {
+        assert(heap.pop() == *s.begin());
+        s.erase(s.begin());
+    }
+}
+
+// Checks that every outstanding handle still points to its value
+static void check_handles(const binomial_heap<int>& heap, const vector<binomial_heap<int>::handle_type>& handle,
+                          const vector<int>& live)
+{
+    for(int id: live)
+        assert(id_of(value_of(heap, handle[id])) == id);
+}
+
+// decrease_key, erase and merge move elements around by relinking them, not
+// by moving values, so every handle must keep pointing to its own value
+static void test_binomial_handles(unsigned seed)
+{
+    mt19937 r(seed);
+    binomial_heap<int> heap;
+    multiset<int> s;
+    vector<binomial_heap<int>::handle_type> handle;
+    vector<int> live;
+    auto forget = [&](int id)
+    {
+        for(size_t k = 0; k < live.size(); k++)
+        {
+            if(live[k] == id)
+            {
+                live[k] = live.back();
+                live.pop_back();
+                return;
+            }
+        }
+        assert(false);
+    };
+    for(int i = 0; i < 20000; i++)
+    {
+        unsigned op = r() % 10;
+        if(op < 3 || s.size() < 2)
+        {
+            int v = make_value(r() % 1024, handle.size());
+            live.push_back(handle.size());
+            handle.push_back(heap.push(v));
+            s.insert(v);
+        }
+        else if(op < 4)
+        {
+            int v = heap.pop();
+            assert(v == *s.begin());
+            s.erase(s.begin());
+            forget(id_of(v));
+        }
+        else if(op < 6)
+        {
+            int id = live[r() % live.size()];
+            int old_value = *handle[id];
+            int v = make_value(r() % ((old_value >> id_bits) + 1), id);
+            heap.decrease_key(handle[id], v);
+            s.erase(old_value);
+            s.insert(v);
+        }
+        else if(op < 8)
+        {
+            int id = r() % 4 ? live[r() % live.size()] : id_of(heap.top());
+            s.erase(*handle[id]);
+            heap.erase(handle[id]);
+            forget(id);
+        }
+        else
+        {
+            binomial_heap<int> other;
+            for(unsigned k = r() % 20; k > 0; k--)
+            {
+                int v = make_value(r() % 1024, handle.size());
+                live.push_back(handle.size());
+                handle.push_back(other.push(v));
+                s.insert(v);
+            }
+            heap.merge(other);
+        }
+        check_handles(heap, handle, live);
+        assert(heap.size() == s.size() && heap.top() == *s.begin());
+    }
+}
+
+// Exposes the trees, to check the shape the next test relies on
+class binomial_probe : public binomial_heap<int>
+{
+public:
+    const binomial_heap_element* root(size_t degree) const
+    {
+        return degree < nodes.size() ? nodes[degree] : nullptr;
+    }
+};
+
+// Pushing eight increasing values builds a single tree; numbering the
+// elements by push order:
+//   0 -> children 4, 2, 1 (first child first)
+//   4 -> children 6, 5     6 -> child 7     2 -> child 3
+// Each element in turn is erased from, or decreased to the minimum in, a
+// fresh heap of that shape: the root, first children (4, 6, 7, 3) and later
+// siblings (2, 1, 5)
+static void test_binomial_shapes()
+{
+    binomial_probe shape;
+    for(int i = 0; i < 8; i++)
+        shape.push(i);
+    auto root = shape.root(3);
+    assert(root && root->value == 0 && shape.root(0) == nullptr);
+    auto c4 = root->child;
+    assert(c4->value == 4 && c4->sibling->value == 2 && c4->sibling->sibling->value == 1);
+    assert(c4->child->value == 6 && c4->child->sibling->value == 5 && c4->child->child->value == 7);
+    assert(c4->sibling->child->value == 3);
+    for(int target = 0; target < 8; target++)
+    {
+        for(int decrease = 0; decrease < 2; decrease++)
+        {
+            binomial_heap<int> heap;
+            vector<binomial_heap<int>::handle_type> handle;
+            vector<int> live;
+            multiset<int> s;
+            for(int i = 0; i < 8; i++)
+            {
+                handle.push_back(heap.push(make_value(i + 1, i)));
+                live.push_back(i);
+                s.insert(make_value(i + 1, i));
+            }
+            s.erase(make_value(target + 1, target));
+            if(decrease)
+            {
+                heap.decrease_key(handle[target], make_value(0, target));
+                s.insert(make_value(0, target));
+                assert(heap.top() == make_value(0, target));
+            }
+            else
+            {
+                heap.erase(handle[target]);
+                live.erase(live.begin() + target);
+            }
+            check_handles(heap, handle, live);
+            for(int v: s)
+            {
+                assert(heap.pop() == v);
+                live.erase(find(live.begin(), live.end(), id_of(v)));
+                check_handles(heap, handle, live);
+            }
+            assert(heap.empty());
+        }
+    }
+}
+
+// Values that own memory, so the sanitizer sees any node that is not
+// destroyed or destroyed twice
+static void test_owning_values()
+{
+    binomial_heap<string> b;
+    pairing_heap_container<string> p;
+    compact_pairing_heap<string> c;
+    for(int i = 0; i < 1000; i++)
+    {
+        string v = "value number " + to_string(i * 7919 % 1000);
+        b.push(v);
+        p.push(v);
+        c.push(v);
+    }
+    for(int i = 0; i < 500; i++)
+    {
+        string v = b.pop();
+        assert(p.pop() == v && c.pop() == v);
+    }
+    binomial_heap<string> copy(b);
+    assert(copy.size() == 500 && copy.top() == b.top());
+}
+
+int main()
+{
+    test_against_multiset<binomial_heap<int>, binomial_heap<int>::handle_type>(1);
+    test_against_multiset<pairing_heap_container<int, less<int>, policy::two_pass>,
+                          pairing_heap<int, less<int>, policy::two_pass>*>(2);
+    test_against_multiset<pairing_heap_container<int, less<int>, policy::multipass>,
+                          pairing_heap<int, less<int>, policy::multipass>*>(3);
+    test_against_multiset<compact_pairing_heap<int, less<int>, policy::two_pass>, uint32_t>(4);
+    test_against_multiset<compact_pairing_heap<int, less<int>, policy::multipass>, uint32_t>(5);
+    test_binomial_merge_copy(6);
+    test_binomial_handles(9);
+    test_binomial_shapes();
+    test_container_merge<policy::two_pass>(7);
+    test_container_merge<policy::multipass>(8);
+    test_owning_values();
+    puts("heap: ok");
+}
@@ -0,0 +1,142 @@
+/*
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O1 -g -fsanitize=address,undefined -fno-sanitize-recover=undefined test/min_cost_flow_test.cpp -o min_cost_flow_test -pthread && ./min_cost_flow_test
+*/
+
+#undef NDEBUG
+
+#include <cassert>
+#include <climits>
+#include <cstdio>
+#include <random>
+
+#include "../flow.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+typedef vector<tuple<size_t, size_t, long long, long long>> edge_list;
+
+// Successive shortest paths with Bellman-Ford, one path at a time
+static pair<long long, long long> reference(size_t n, const edge_list& edges, size_t source, size_t sink, long long limit)
+{
+    vector<size_t> to, tail;
+    vector<long long> cap, cost;
+    for(const auto& i: edges)
+    {
+        tail.push_back(get<0>(i));
+        to.push_back(get<1>(i));
+        cap.push_back(get<2>(i));
+        cost.push_back(get<3>(i));
+        tail.push_back(get<1>(i));
+        to.push_back(get<0>(i));
+        cap.push_back(0);
+        cost.push_back(-get<3>(i));
+    }
+    long long value = 0, total = 0;
+    while(value < limit)
+    {
+        vector<long long> dist(n, LLONG_MAX);
+        vector<size_t> parent(n, SIZE_MAX);
+        dist[source] = 0;
+        for(size_t round = 0; round < n; round++)
+        {
+            for(size_t a = 0; a < to.size(); a++)
+            {
+                if(cap[a] > 0 && dist[tail[a]] != LLONG_MAX && dist[tail[a]] + cost[a] < dist[to[a]])
+                {
+                    dist[to[a]] = dist[tail[a]] + cost[a];
+                    parent[to[a]] = a;
+                }
+            }
+        }
+        if(dist[sink] == LLONG_MAX)
+            break;
+        long long quantity = limit - value;
+        for(size_t v = sink; v != source; v = tail[parent[v]])
+            quantity = min(quantity, cap[parent[v]]);
+        for(size_t v = sink; v != source; v = tail[parent[v]])
+        {
+            cap[parent[v]] -= quantity;
+            cap[parent[v] ^ 1] += quantity;
+        }
+        value += quantity;
+        total += quantity * dist[sink];
+    }
+    return {value, total};
+}
+
+template<typename U>
+static void test_random(unsigned seed)
+{
+    mt19937 r(seed);
+    for(int it = 0; it < 5000; it++)
+    {
+        size_t n = 2 + r() % 9;
+        size_t m = r() % 30;
+        // Negative costs only on edges going up, so there is no negative cycle
+        bool negative = it % 2;
+        edge_list edges;
+        for(size_t i = 0; i < m; i++)
+        {
+            size_t u = r() % n, v = r() % n;
+            long long c = negative ? (u < v ? (long long)(r() % 16) - 5 : 5 * (long long)n + (long long)(r() % 10)) : (long long)(r() % 10);
+            edges.emplace_back(u, v, (long long)(r() % 8), c);
+        }
+        size_t s = r() % n, t = r() % n;
+        if(s == t)
+            t = (s + 1) % n;
+        long long limit = r() % 3 ? LLONG_MAX : (long long)(r() % 12);
+        auto expected = reference(n, edges, s, t, limit);
+        auto got = min_cost_flow<long long, long long, U>(n, edges, s, t, limit);
+        assert(got.value == expected.first && got.cost == expected.second);
+        vector<long long> balance(n, 0);
+        long long total = 0;
+        for(size_t i = 0; i < m; i++)
+        {
+            long long f = got.edge_flow[i];
+            assert(f >= 0 && f <= get<2>(edges[i]));
+            balance[get<0>(edges[i])] -= f;
+            balance[get<1>(edges[i])] += f;
+            total += f * get<3>(edges[i]);
+        }
+        for(size_t v = 0; v < n; v++)
+            assert(v == s || v == t || balance[v] == 0);
+        assert(balance[t] == got.value && total == got.cost);
+    }
+}
+
+// Costs near 1e6 on 4004 vertices overflow int once scaled by V, and the
+// default limit must not overflow the capacity out of the source
+static void test_int_headroom()
+{
+    mt19937 r(1);
+    size_t suppliers = 2000, consumers = 2000;
+    size_t n = suppliers + consumers + 2, s = n - 2, t = n - 1;
+    vector<tuple<size_t, size_t, int, int>> edges;
+    for(size_t i = 0; i < suppliers; i++)
+        edges.emplace_back(s, i, 100 + int(r() % 900), 0);
+    for(size_t j = 0; j < consumers; j++)
+        edges.emplace_back(suppliers + j, t, 100 + int(r() % 900), 0);
+    for(size_t i = 0; i < suppliers; i++)
+    {
+        for(int k = 0; k < 5; k++)
+            edges.emplace_back(i, suppliers + r() % consumers, 50 + int(r() % 500), int(r() % 1000000));
+    }
+    auto a = min_cost_flow<int, int, policy::cost_scaling>(n, edges, s, t, 1000);
+    auto b = min_cost_flow<int, int, policy::pairing>(n, edges, s, t, 1000);
+    assert(a.value == 1000 && a.value == b.value && a.cost == b.cost);
+    vector<tuple<size_t, size_t, int, int>> wide = {{0, 1, INT_MAX, 1}, {0, 2, INT_MAX, 1}, {1, 3, 5, 1}, {2, 3, 7, 2}};
+    auto c = min_cost_flow<int, int>(4, wide, 0, 3);
+    assert(c.value == 12 && c.cost == 31);
+}
+
+int main()
+{
+    test_random<policy::cost_scaling>(1);
+    test_random<policy::pairing>(2);
+    test_random<policy::binomial>(3);
+    test_random<policy::lazy>(4);
+    test_int_headroom();
+    puts("min_cost_flow: ok");
+}
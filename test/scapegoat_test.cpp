@@ -0,0 +1,216 @@
+/*
+ * Build and run from the repository root:
+ *   g++ -std=c++17 -O1 -g -fsanitize=address,undefined test/scapegoat_test.cpp -o scapegoat_test -pthread && ./scapegoat_test
+ * The concurrent test is also worth running with -fsanitize=thread.
+*/
+
+#undef NDEBUG
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../scapegoat.hpp"
+
+using namespace std;
+using namespace ostuni;
+
+// Erasing a key that is already gone must not hand its slot out twice
+template<typename Tree>
+static void test_erase_missing()
+{
+    Tree t;
+    assert(!t.erase(1));
+    assert(t.insert(1));
+    assert(t.erase(1));
+    assert(!t.erase(1));
+    assert(t.size() == 0);
+    assert(t.insert(2));
+    assert(t.insert(3));
+    assert(t.size() == 2);
+    assert(t.find(2) && t.find(3) && !t.find(1));
+}
+
+template<typename Tree>
+static void test_against_set(unsigned seed)
+{
+    mt19937 r(seed);
+    Tree t;
+    set<int> s;
+    for(int i = 0; i < 200000; i++)
+    {
+        int v = r() % 1000;
+        switch(r() % 3)
+        {
+        case 0:
+            assert(t.insert(v) == s.insert(v).second);
+            break;
+        case 1:
+            assert(t.erase(v) == (s.erase(v) == 1));
+            break;
+        default:
+            assert(t.find(v) == (s.count(v) == 1));
+        }
+        assert(t.size() == s.size());
+    }
+}
+
+// Counts its copies, so a test can tell a move from a copy
+class counted
+{
+public:
+    static long copies;
+    int v;
+    counted(int _v = 0) : v(_v)
+    {
+    }
+    counted(const counted& o) : v(o.v)
+    {
+        copies++;
+    }
+    counted(counted&&) noexcept = default;
+    counted& operator=(const counted& o)
+    {
+        v = o.v;
+        copies++;
+        return *this;
+    }
+    counted& operator=(counted&&) noexcept = default;
+    bool operator<(const counted& o) const
+    {
+        return v < o.v;
+    }
+    bool operator==(const counted& o) const
+    {
+        return v == o.v;
+    }
+};
+
+long counted::copies = 0;
+
+// assign_sorted() moves from a move iterator, and merge() and split() move
+// the values into the rebuilt trees
+template<typename Layout>
+static void test_moves()
+{
+    vector<counted> values;
+    for(int i = 0; i < 1000; i++)
+        values.emplace_back(2 * i);
+    scapegoat<counted, Layout> t, o;
+    counted::copies = 0;
+    t.assign_sorted(make_move_iterator(values.begin()), make_move_iterator(values.end()));
+    assert(counted::copies == 0);
+    assert(t.size() == 1000 && t.find(counted(1998)));
+    values.clear();
+    for(int i = 0; i < 1000; i++)
+        values.emplace_back(2 * i + 1);
+    o.assign_sorted(make_move_iterator(values.begin()), make_move_iterator(values.end()));
+    counted::copies = 0;
+    t.merge(o);
+    scapegoat<counted, Layout> upper = t.split(counted(1000));
+    assert(counted::copies == 0);
+    assert(t.size() == 1000 && upper.size() == 1000 && o.size() == 0);
+    assert(t.select(999).v == 999 && upper.select(0).v == 1000);
+    // A plain range is copied and left alone
+    vector<counted> plain = {counted(1), counted(2), counted(3)};
+    counted::copies = 0;
+    o.assign_sorted(plain.begin(), plain.end());
+    assert(counted::copies == 3);
+    assert(o.size() == 3 && plain.size() == 3 && plain[2].v == 3);
+}
+
+// select() checks its bound on the snapshot it reads, so it fails rather
+// than reading past the tree or returning an erased value from a stale root
+static void test_concurrent_select()
+{
+    concurrent_scapegoat<int> t;
+    int v = -1;
+    assert(!t.select(0, v) && v == -1);
+    assert(t.insert(5) && t.insert(7));
+    assert(t.select(1, v) && v == 7);
+    assert(!t.select(2, v) && v == 7);
+    assert(t.erase(5) && t.erase(7));
+    assert(!t.select(0, v) && v == 7);
+}
+
+// Readers check every snapshot while one writer toggles the odd values:
+// the even ones are always there, rank() and select() agree, and a
+// select() past the end fails instead of reading out of the tree
+template<typename Layout>
+static void test_concurrent_readers()
+{
+    const int n = 20000;
+    concurrent_scapegoat<int, Layout> t;
+    for(int i = 0; i < n; i += 2)
+        t.insert(i);
+    atomic<bool> stop(false);
+    atomic<long> reads(0);
+    vector<thread> readers;
+    for(unsigned k = 0; k < 3; k++)
+    {
+        readers.emplace_back([&, k]()
+        {
+            mt19937 r(k);
+            long count = 0;
+            while(!stop.load())
+            {
+                int v = (r() % (n / 2)) * 2;
+                assert(t.find(v));
+                t.read([&](const scapegoat<int, Layout>& tree)
+                {
+                    size_t position = tree.rank(v);
+                    assert(position >= size_t(v / 2) && position <= size_t(v));
+                    assert(tree.select(position) == v);
+                    assert(tree.size() >= size_t(n / 2) && tree.size() <= size_t(n));
+                    assert(tree.count_range(0, n) == tree.size());
+                    return 0;
+                });
+                int w;
+                size_t k = n / 2 + r() % (n / 2 + 1);
+                if(t.select(k, w))
+                    assert(w >= 0 && w < n && k < size_t(n));
+                count++;
+            }
+            reads += count;
+        });
+    }
+    mt19937 r(99);
+    set<int> odd;
+    for(int i = 0; i < 2000; i++)
+    {
+        int v = (r() % (n / 2)) * 2 + 1;
+        if(r() & 1)
+            assert(t.insert(v) == odd.insert(v).second);
+        else
+            assert(t.erase(v) == (odd.erase(v) == 1));
+    }
+    stop.store(true);
+    for(auto& i: readers)
+        i.join();
+    assert(reads.load() > 0);
+    assert(t.size() == size_t(n / 2) + odd.size());
+    for(int v = 0; v < n; v++)
+        assert(t.find(v) == (v % 2 == 0 || odd.count(v) == 1));
+}
+
+int main()
+{
+    test_erase_missing<scapegoat<int>>();
+    test_erase_missing<scapegoat<int, policy::bfs_order>>();
+    test_erase_missing<scapegoat<int, policy::veb_order>>();
+    test_erase_missing<concurrent_scapegoat<int>>();
+    test_against_set<scapegoat<int>>(1);
+    test_against_set<scapegoat<int, policy::bfs_order>>(2);
+    test_against_set<scapegoat<int, policy::veb_order>>(3);
+    test_moves<policy::allocation_order>();
+    test_moves<policy::bfs_order>();
+    test_moves<policy::veb_order>();
+    test_concurrent_select();
+    test_concurrent_readers<policy::allocation_order>();
+    test_concurrent_readers<policy::veb_order>();
+    puts("scapegoat: ok");
+}